@@ -0,0 +1,355 @@
+// Micro-benchmarks for the server's hot paths
+// cache, hashing, the db lookup key, JSON bodies and primes, with no MySQL or running server
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include "../cache/cache.h"
+#include "../cache/hash_cache.h"
+#include "../compute/hash.h"
+#include "../compute/primes.h"
+#include "../compute/sieve.h"
+#include "../server/kv_json.h"
+
+using namespace std;
+using namespace chrono;
+
+// Google Benchmark style: a body runs n iterations, the harness grows n
+// until one run takes at least min_ms, and threaded variants run the body
+// on every thread at once (released together, timed to the last one done).
+// Time/op is wall time per iteration of one thread, ops/s counts all threads.
+struct Bench
+{
+    string name;
+    int threads;
+    size_t bytes; // per iteration, for GB/s (0 = not shown)
+    function<void(long n, int thread)> body;
+};
+
+// keeps a result alive so the compiler can't drop the work (DoNotOptimize)
+template <class T>
+inline void keep(const T &v) { asm volatile("" : : "g"(&v) : "memory"); }
+
+static double run_once(const Bench &b, long n)
+{
+    if (b.threads == 1)
+    {
+        auto start = steady_clock::now();
+        b.body(n, 0);
+        return duration<double>(steady_clock::now() - start).count();
+    }
+
+    atomic<int> ready{0};
+    atomic<bool> go{false};
+    vector<thread> workers;
+    for (int t = 0; t < b.threads; t++)
+    {
+        workers.emplace_back([&, t]
+                             {
+            ready++;
+            while (!go.load())
+                this_thread::yield();
+            b.body(n, t); });
+    }
+    while (ready.load() < b.threads)
+        this_thread::yield();
+    auto start = steady_clock::now();
+    go = true;
+    for (auto &w : workers)
+        w.join();
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+static void run(const Bench &b, int min_ms)
+{
+    long n = 1;
+    double secs;
+    for (;;)
+    {
+        secs = run_once(b, n);
+        if (secs * 1000 >= min_ms || n >= 1000000000L)
+            break;
+        // aim past min_ms, growing at most 10x a step
+        double want = secs > 0 ? n * (min_ms / 1000.0) * 1.4 / secs : n * 10.0;
+        n = (long)min(max(want, n + 1.0), n * 10.0);
+    }
+
+    double ns = secs * 1e9 / n;
+    double ops = (double)n * b.threads / secs;
+    cout << left << setw(40) << b.name << right << fixed << setprecision(1)
+         << setw(12) << ns << " ns" << setw(14) << n;
+    if (ops >= 1e6)
+        cout << setw(12) << setprecision(2) << ops / 1e6 << "M/s";
+    else
+        cout << setw(12) << setprecision(0) << ops << " /s";
+    if (b.bytes)
+        cout << setw(10) << setprecision(2) << ops * b.bytes / 1e9 << " GB/s";
+    cout << "\n";
+}
+
+static string text(size_t len, uint64_t seed)
+{
+    static const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    mt19937_64 rng(seed);
+    string s(len, ' ');
+    for (auto &c : s)
+        c = charset[rng() % 62];
+    return s;
+}
+
+static vector<string> numbered(const string &prefix, int count)
+{
+    vector<string> out;
+    for (int i = 0; i < count; i++)
+        out.push_back(prefix + to_string(i));
+    return out;
+}
+
+static void usage(const char *prog)
+{
+    cout << "Usage: " << prog << " [options] [FILTER]\n"
+         << "  FILTER           run only benchmarks whose name contains it (e.g. cache/)\n"
+         << "  --min-ms N       minimum time per benchmark (default: 200)\n"
+         << "  --max-threads N  largest thread count for the cache runs (default: cores, at least 4)\n"
+         << "  --list           print the benchmark names and exit\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int min_ms = 200;
+    int max_threads = max(4u, thread::hardware_concurrency());
+    string filter;
+    bool list_only = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--min-ms" && i + 1 < argc)
+            min_ms = atoi(argv[++i]);
+        else if (arg == "--max-threads" && i + 1 < argc)
+            max_threads = atoi(argv[++i]);
+        else if (arg == "--list")
+            list_only = true;
+        else if (arg == "--help" || arg[0] == '-')
+        {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+            filter = arg;
+    }
+    if (min_ms < 1 || max_threads < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    vector<Bench> benches;
+    vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    // ---- cache: 1000 entries of 100 bytes, as cache_size = 1000 ----
+    const int CACHED = 1000;
+    string value = text(100, 1);
+    vector<string> keys = numbered("key_", 4 * CACHED); // key_0 .. key_999 cached
+    vector<string> missing = numbered("missing_", CACHED);
+    Cache warm(CACHED);
+    for (int i = 0; i < CACHED; i++)
+        warm.put(keys[i], value);
+    Cache churn(CACHED); // puts over 4x the capacity, so most of them evict
+
+    for (int t : thread_counts)
+    {
+        string suffix = "/threads:" + to_string(t);
+        benches.push_back({"cache/get_hit" + suffix, t, 0, [&](long n, int th)
+                           {
+                               string v;
+                               for (long i = 0; i < n; i++)
+                               {
+                                   warm.get(keys[(i * 7 + th * 131) % CACHED], v);
+                                   keep(v);
+                               }
+                           }});
+        benches.push_back({"cache/get_miss" + suffix, t, 0, [&](long n, int th)
+                           {
+                               string v;
+                               for (long i = 0; i < n; i++)
+                                   keep(warm.get(missing[(i * 7 + th * 131) % CACHED], v));
+                           }});
+        benches.push_back({"cache/put_evict" + suffix, t, 0, [&](long n, int th)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   churn.put(keys[(i * 7 + th * 131) % keys.size()], value);
+                           }});
+        // the /kv/read path: 9 reads to 1 create, keys over 2x the capacity
+        benches.push_back({"cache/mixed_90_10" + suffix, t, 0, [&](long n, int th)
+                           {
+                               string v;
+                               for (long i = 0; i < n; i++)
+                               {
+                                   const string &k = keys[(i * 7 + th * 131) % (2 * CACHED)];
+                                   if (i % 10 == 9)
+                                       churn.put(k, value);
+                                   else
+                                       keep(churn.get(k, v));
+                               }
+                           }});
+    }
+
+    HashCache hash_warm(CACHED);
+    vector<Hash::Fingerprint> prints;
+    for (auto &k : numbered("text_", CACHED))
+    {
+        prints.push_back(Hash::fingerprint(k));
+        hash_warm.put(prints.back(), 1);
+    }
+    for (int t : {1, max_threads})
+    {
+        benches.push_back({"hash_cache/get_hit/threads:" + to_string(t), t, 0, [&](long n, int th)
+                           {
+                               uint32_t v;
+                               for (long i = 0; i < n; i++)
+                                   keep(hash_warm.get(prints[(i * 7 + th * 131) % CACHED], v));
+                           }});
+    }
+
+    // ---- hashing: the /compute/hash algorithms and the hash_store key ----
+    static string texts[] = {text(16, 2), text(256, 3), text(4096, 4), text(65536, 5)};
+    for (const string &s : texts)
+    {
+        string len = "/" + to_string(s.size());
+        benches.push_back({"hash/poly31" + len, 1, s.size(), [&s](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(Hash::poly31(s.data(), s.size()));
+                           }});
+        benches.push_back({"hash/xxh3" + len, 1, s.size(), [&s](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(Hash::xxh3(s.data(), s.size()));
+                           }});
+        benches.push_back({"hash/wyhash" + len, 1, s.size(), [&s](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(Hash::wyhash(s.data(), s.size()));
+                           }});
+        benches.push_back({"hash/fingerprint" + len, 1, s.size(), [&s](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(Hash::fingerprint(s));
+                           }});
+        benches.push_back({"hash/compute_text_hash" + len, 1, s.size(), [&s](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(compute_text_hash(s));
+                           }});
+    }
+
+    // ---- JSON bodies, with the builders the /kv handlers use ----
+    static string small_val = text(16, 6), large_val = text(1000, 7);
+    for (const string *val : {&small_val, &large_val})
+    {
+        benches.push_back({"json/kv_read/" + to_string(val->size()), 1, 0, [&keys, val](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                                   keep(KVJson::read(keys[i % CACHED], *val, "cache"));
+                           }});
+    }
+    benches.push_back({"json/kv_create/16", 1, 0, [&keys](long n, int)
+                       {
+                           for (long i = 0; i < n; i++)
+                               keep(KVJson::created(keys[i % CACHED], small_val, i & 1, small_val));
+                       }});
+    for (int count : {10, 100})
+    {
+        benches.push_back({"json/kv_mget/" + to_string(count), 1, 0, [&keys, count](long n, int)
+                           {
+                               vector<string> batch(keys.begin(), keys.begin() + count);
+                               vector<string> vals(count, text(100, 8));
+                               vector<const char *> sources(count, "cache");
+                               int found = count;
+                               for (int k = 0; k < count; k += 3, found--)
+                                   sources[k] = nullptr;
+                               for (long i = 0; i < n; i++)
+                                   keep(KVJson::mget(batch, vals, sources, found));
+                           }});
+    }
+
+    // ---- primes: the /compute routes ----
+    static PrimeTable table(10000);
+    static PrimeSieve sieve;
+    for (int count : {10, 1000, 10000})
+    {
+        benches.push_back({"prime/table_first/" + to_string(count), 1, 0, [count](long n, int)
+                           {
+                               for (long i = 0; i < n; i++)
+                               {
+                                   string json;
+                                   json.reserve(64 + count * 6);
+                                   json += "{\"success\": true, \"count\": " + to_string(count) + ", \"primes\": \"";
+                                   table.append_first(count, json);
+                                   json += "\"}";
+                                   keep(json);
+                               }
+                           }});
+    }
+    benches.push_back({"prime/table_build/10000", 1, 0, [](long n, int)
+                       {
+                           for (long i = 0; i < n; i++)
+                           {
+                               PrimeTable t(10000);
+                               keep(t);
+                           }
+                       }});
+    benches.push_back({"prime/is_prime/1e12", 1, 0, [](long n, int)
+                       {
+                           for (long i = 0; i < n; i++)
+                               keep(PrimeSieve::is_prime(1000000000001ULL + 2 * (i % 1000)));
+                       }});
+    benches.push_back({"prime/sieve_list/1e6_span", 1, 0, [](long n, int)
+                       {
+                           for (long i = 0; i < n; i++)
+                               keep(sieve.list(1000000000000ULL, 1000000000000ULL + 1000000, SIZE_MAX));
+                       }});
+
+    if (list_only)
+    {
+        for (auto &b : benches)
+            cout << b.name << "\n";
+        return 0;
+    }
+
+    cout << "========================================\n";
+    cout << "  KV Micro-benchmarks\n";
+    cout << "========================================\n";
+    cout << "min " << min_ms << " ms per benchmark, up to " << max_threads << " threads, "
+         << thread::hardware_concurrency() << " cores, xxh3 " << Hash::xxh3_path() << "\n\n";
+    cout << left << setw(40) << "Benchmark" << right << setw(15) << "Time/op" << setw(14) << "Iterations"
+         << setw(15) << "Ops" << "\n";
+    cout << string(84, '-') << "\n";
+
+    int ran = 0;
+    for (auto &b : benches)
+    {
+        if (!filter.empty() && b.name.find(filter) == string::npos)
+            continue;
+        run(b, min_ms);
+        ran++;
+    }
+    if (!ran)
+    {
+        cerr << "No benchmark matches '" << filter << "' (see --list)\n";
+        return 1;
+    }
+    return 0;
+}
@@ -4,36 +4,70 @@
 #include <string>
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include <mutex>
+#include <algorithm>
+#include <functional>
+#include "../include/profile.h"
 
 using namespace std;
 
-// simple LRU cache
-class Cache
+// simple LRU cache, K and V copyable, KeyHash hashes K
+template <class K, class V, class KeyHash = hash<K>>
+class LRUCache
 {
 private:
     struct Node
     {
-        string k;
-        string v;
+        K k;
+        V v;
     };
 
     int max_size;
     list<Node> items;
-    unordered_map<string, list<Node>::iterator> map;
+    unordered_map<K, typename list<Node>::iterator, KeyHash> map;
     mutex mtx;
 
     int hits = 0;
     int misses = 0;
     int evicts = 0;
 
+    // insert or update, caller holds mtx
+    void insert(const K &key, const V &val)
+    {
+        auto it = map.find(key);
+        if (it != map.end())
+        {
+            // update existing
+            items.splice(items.begin(), items, it->second);
+            it->second->v = val;
+            return;
+        }
+
+        // check if full
+        if (items.size() >= (size_t)max_size)
+        {
+            // remove last item
+            map.erase(items.back().k);
+            items.pop_back();
+            evicts++;
+        }
+
+        // add new item
+        items.push_front({key, val});
+        map[key] = items.begin();
+    }
+
 public:
-    Cache(int size) : max_size(size) {}
+    // holds at least one item
+    LRUCache(int size) : max_size(max(size, 1)) {}
 
     // get value from cache
-    bool get(const string &key, string &val)
+    bool get(const K &key, V &val)
     {
+        ProfileTimer wait(Profile::CACHE_LOCK);
         lock_guard<mutex> lock(mtx);
+        wait.stop();
 
         auto it = map.find(key);
         if (it == map.end())
@@ -49,39 +83,58 @@ public:
         return true;
     }
 
-    // add to cache
-    void put(const string &key, const string &val)
+    // look up several keys under one lock, returns number of hits
+    int get_many(const vector<K> &keys, vector<V> &vals, vector<bool> &found)
     {
+        ProfileTimer wait(Profile::CACHE_LOCK);
         lock_guard<mutex> lock(mtx);
+        wait.stop();
 
-        auto it = map.find(key);
-        if (it != map.end())
+        vals.assign(keys.size(), V());
+        found.assign(keys.size(), false);
+        int n = 0;
+        for (size_t i = 0; i < keys.size(); i++)
         {
-            // update existing
+            auto it = map.find(keys[i]);
+            if (it == map.end())
+            {
+                misses++;
+                continue;
+            }
             items.splice(items.begin(), items, it->second);
-            it->second->v = val;
-            return;
+            vals[i] = it->second->v;
+            found[i] = true;
+            hits++;
+            n++;
         }
+        return n;
+    }
 
-        // check if full
-        if (items.size() >= (size_t)max_size)
-        {
-            // remove last item
-            auto last = items.back();
-            map.erase(last.k);
-            items.pop_back();
-            evicts++;
-        }
+    // add to cache
+    void put(const K &key, const V &val)
+    {
+        ProfileTimer wait(Profile::CACHE_LOCK);
+        lock_guard<mutex> lock(mtx);
+        wait.stop();
+        insert(key, val);
+    }
 
-        // add new item
-        items.push_front({key, val});
-        map[key] = items.begin();
+    // add several items under one lock
+    void put_many(const vector<pair<K, V>> &kvs)
+    {
+        ProfileTimer wait(Profile::CACHE_LOCK);
+        lock_guard<mutex> lock(mtx);
+        wait.stop();
+        for (auto &kv : kvs)
+            insert(kv.first, kv.second);
     }
 
     // remove from cache
-    void remove(const string &key)
+    void remove(const K &key)
     {
+        ProfileTimer wait(Profile::CACHE_LOCK);
         lock_guard<mutex> lock(mtx);
+        wait.stop();
 
         auto it = map.find(key);
         if (it != map.end())
@@ -101,6 +154,19 @@ public:
         int total = hits + misses;
         return total > 0 ? (double)hits / total * 100.0 : 0.0;
     }
+
+    // rough memory use: list node + hash node + bucket per entry,
+    // not counting anything K or V allocate themselves
+    size_t bytes()
+    {
+        size_t per_entry = (sizeof(Node) + 2 * sizeof(void *)) +
+                           (sizeof(K) + sizeof(typename list<Node>::iterator) + sizeof(void *)) +
+                           sizeof(void *);
+        return items.size() * per_entry;
+    }
 };
 
+// the kv cache
+using Cache = LRUCache<string, string>;
+
 #endif
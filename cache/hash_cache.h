@@ -0,0 +1,22 @@
+#ifndef HASH_CACHE_H
+#define HASH_CACHE_H
+
+#include <cstdint>
+#include "cache.h"
+#include "../compute/hash.h"
+
+using namespace std;
+
+// the fingerprint is already well mixed, use half of it as the bucket hash
+struct FingerprintHash
+{
+    size_t operator()(const Hash::Fingerprint &f) const { return f.a; }
+};
+
+// LRU cache for /compute/hash results
+// keyed by the text's 128-bit fingerprint instead of the text itself, value
+// is the 32-bit hash, so an entry is a few dozen bytes whatever the text
+// length and a lookup compares two integers instead of the whole string
+using HashCache = LRUCache<Hash::Fingerprint, uint32_t, FingerprintHash>;
+
+#endif
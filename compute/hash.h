@@ -0,0 +1,678 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// text hashing for /compute/hash and the db lookup key
+//
+//   poly31  h = h * 31 + c, 32-bit (the original /compute/hash value)
+//   xxh3    XXH3-64, seed 0, same output as the reference xxHash;
+//           inputs over 240 bytes use AVX2 / SSE2 / scalar, picked at runtime
+//   wyhash  wyhash final4 construction, seed 0
+namespace Hash
+{
+    enum Algo
+    {
+        POLY31,
+        XXH3,
+        WYHASH,
+    };
+
+    inline const char *name(Algo a)
+    {
+        switch (a)
+        {
+        case XXH3:
+            return "xxh3";
+        case WYHASH:
+            return "wyhash";
+        default:
+            return "poly31";
+        }
+    }
+
+    inline bool parse(const string &s, Algo &a)
+    {
+        for (Algo x : {POLY31, XXH3, WYHASH})
+        {
+            if (s == name(x))
+            {
+                a = x;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline uint32_t read32(const char *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    inline uint64_t read64(const char *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    // low ^ high half of the 128-bit product
+    inline uint64_t mul_fold64(uint64_t a, uint64_t b)
+    {
+        unsigned __int128 r = (unsigned __int128)a * b;
+        return (uint64_t)r ^ (uint64_t)(r >> 64);
+    }
+
+    // ---- poly31 ----
+
+    // same value as the byte loop (chars are sign-extended like before),
+    // 8 bytes per step so the multiplies don't form one long chain
+    inline uint32_t poly31(const char *p, size_t len, uint32_t h = 0)
+    {
+        const uint32_t P1 = 31, P2 = P1 * P1, P3 = P2 * P1, P4 = P3 * P1,
+                       P5 = P4 * P1, P6 = P5 * P1, P7 = P6 * P1, P8 = P7 * P1;
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            h = h * P8 + (uint32_t)(int8_t)p[i] * P7 + (uint32_t)(int8_t)p[i + 1] * P6 +
+                (uint32_t)(int8_t)p[i + 2] * P5 + (uint32_t)(int8_t)p[i + 3] * P4 +
+                (uint32_t)(int8_t)p[i + 4] * P3 + (uint32_t)(int8_t)p[i + 5] * P2 +
+                (uint32_t)(int8_t)p[i + 6] * P1 + (uint32_t)(int8_t)p[i + 7];
+        }
+        for (; i < len; i++)
+            h = h * 31 + (uint32_t)(int8_t)p[i];
+        return h;
+    }
+
+    // ---- xxh3 ----
+
+    namespace XXH
+    {
+        const uint32_t PRIME32_1 = 0x9E3779B1U;
+        const uint32_t PRIME32_2 = 0x85EBCA77U;
+        const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+        const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+        const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+        const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+        const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+        const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+        const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+        const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+        const size_t SECRET_SIZE = 192;
+        const size_t STRIPE = 64;
+        const size_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE) / 8;
+        const size_t BLOCK = STRIPE * STRIPES_PER_BLOCK;
+
+        alignas(64) static const unsigned char SECRET[SECRET_SIZE] = {
+            0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+            0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+            0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+            0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+            0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+            0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+            0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+            0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+            0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+            0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+            0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+            0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+        };
+
+        inline const char *secret() { return (const char *)SECRET; }
+
+        inline uint64_t xxh64_avalanche(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= PRIME64_2;
+            h ^= h >> 29;
+            h *= PRIME64_3;
+            return h ^ (h >> 32);
+        }
+
+        inline uint64_t avalanche(uint64_t h)
+        {
+            h ^= h >> 37;
+            h *= PRIME_MX1;
+            return h ^ (h >> 32);
+        }
+
+        inline uint64_t rrmxmx(uint64_t h, uint64_t len)
+        {
+            h ^= rotl64(h, 49) ^ rotl64(h, 24);
+            h *= PRIME_MX2;
+            h ^= (h >> 35) + len;
+            h *= PRIME_MX2;
+            return h ^ (h >> 28);
+        }
+
+        inline uint64_t mix16(const char *p, const char *s)
+        {
+            return mul_fold64(read64(p) ^ read64(s), read64(p + 8) ^ read64(s + 8));
+        }
+
+        inline uint64_t len_0to16(const char *p, size_t len)
+        {
+            const char *s = secret();
+            if (len > 8)
+            {
+                uint64_t lo = read64(p) ^ (read64(s + 24) ^ read64(s + 32));
+                uint64_t hi = read64(p + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+                return avalanche(len + __builtin_bswap64(lo) + hi + mul_fold64(lo, hi));
+            }
+            if (len >= 4)
+            {
+                uint64_t in = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+                return rrmxmx(in ^ (read64(s + 8) ^ read64(s + 16)), len);
+            }
+            if (len > 0)
+            {
+                uint32_t c = ((uint32_t)(uint8_t)p[0] << 16) | ((uint32_t)(uint8_t)p[len >> 1] << 24) |
+                             (uint32_t)(uint8_t)p[len - 1] | ((uint32_t)len << 8);
+                return xxh64_avalanche((uint64_t)c ^ (read32(s) ^ read32(s + 4)));
+            }
+            return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+        }
+
+        inline uint64_t len_17to128(const char *p, size_t len)
+        {
+            const char *s = secret();
+            uint64_t acc = len * PRIME64_1;
+            if (len > 32)
+            {
+                if (len > 64)
+                {
+                    if (len > 96)
+                    {
+                        acc += mix16(p + 48, s + 96);
+                        acc += mix16(p + len - 64, s + 112);
+                    }
+                    acc += mix16(p + 32, s + 64);
+                    acc += mix16(p + len - 48, s + 80);
+                }
+                acc += mix16(p + 16, s + 32);
+                acc += mix16(p + len - 32, s + 48);
+            }
+            acc += mix16(p, s);
+            acc += mix16(p + len - 16, s + 16);
+            return avalanche(acc);
+        }
+
+        inline uint64_t len_129to240(const char *p, size_t len)
+        {
+            const char *s = secret();
+            uint64_t acc = len * PRIME64_1;
+            for (size_t i = 0; i < 8; i++)
+                acc += mix16(p + 16 * i, s + 16 * i);
+            acc = avalanche(acc);
+            for (size_t i = 8; i < len / 16; i++)
+                acc += mix16(p + 16 * i, s + 16 * (i - 8) + 3);
+            acc += mix16(p + len - 16, s + 136 - 17);
+            return avalanche(acc);
+        }
+
+        // one 64-byte stripe into the 8 accumulators
+        inline void accumulate_scalar(uint64_t *acc, const char *p, const char *s)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                uint64_t v = read64(p + 8 * i);
+                uint64_t k = v ^ read64(s + 8 * i);
+                acc[i ^ 1] += v;
+                acc[i] += (uint64_t)(uint32_t)k * (k >> 32);
+            }
+        }
+
+        inline void scramble_scalar(uint64_t *acc, const char *s)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                uint64_t a = acc[i];
+                a ^= a >> 47;
+                a ^= read64(s + 8 * i);
+                acc[i] = a * PRIME32_1;
+            }
+        }
+
+#if defined(__x86_64__)
+        __attribute__((target("sse2"))) inline void accumulate_sse2(uint64_t *acc, const char *p, const char *s)
+        {
+            __m128i *a = (__m128i *)acc;
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)p + i);
+                __m128i k = _mm_xor_si128(v, _mm_loadu_si128((const __m128i *)s + i));
+                __m128i prod = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m128i swap = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                a[i] = _mm_add_epi64(prod, _mm_add_epi64(a[i], swap));
+            }
+        }
+
+        __attribute__((target("sse2"))) inline void scramble_sse2(uint64_t *acc, const char *s)
+        {
+            __m128i *a = (__m128i *)acc;
+            const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i x = _mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47));
+                x = _mm_xor_si128(x, _mm_loadu_si128((const __m128i *)s + i));
+                __m128i lo = _mm_mul_epu32(x, prime);
+                __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(x, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+                a[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+            }
+        }
+
+        __attribute__((target("avx2"))) inline void accumulate_avx2(uint64_t *acc, const char *p, const char *s)
+        {
+            __m256i *a = (__m256i *)acc;
+            for (int i = 0; i < 2; i++)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i *)p + i);
+                __m256i k = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *)s + i));
+                __m256i prod = _mm256_mul_epu32(k, _mm256_srli_epi64(k, 32));
+                __m256i swap = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                a[i] = _mm256_add_epi64(prod, _mm256_add_epi64(a[i], swap));
+            }
+        }
+
+        __attribute__((target("avx2"))) inline void scramble_avx2(uint64_t *acc, const char *s)
+        {
+            __m256i *a = (__m256i *)acc;
+            const __m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+            for (int i = 0; i < 2; i++)
+            {
+                __m256i x = _mm256_xor_si256(a[i], _mm256_srli_epi64(a[i], 47));
+                x = _mm256_xor_si256(x, _mm256_loadu_si256((const __m256i *)s + i));
+                __m256i lo = _mm256_mul_epu32(x, prime);
+                __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+                a[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+            }
+        }
+#endif
+
+        inline void init_acc(uint64_t *acc)
+        {
+            const uint64_t init[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                                      PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+            memcpy(acc, init, sizeof(init));
+        }
+
+        inline uint64_t merge(const uint64_t *acc, uint64_t len)
+        {
+            const char *s = secret();
+            uint64_t result = len * PRIME64_1;
+            for (int i = 0; i < 4; i++)
+                result += mul_fold64(acc[2 * i] ^ read64(s + 11 + 16 * i), acc[2 * i + 1] ^ read64(s + 11 + 16 * i + 8));
+            return avalanche(result);
+        }
+
+        // everything over 240 bytes: stripes into 8 lanes, scrambled once per block
+        template <void (*ACC)(uint64_t *, const char *, const char *), void (*SCRAMBLE)(uint64_t *, const char *)>
+        __attribute__((always_inline)) inline uint64_t hash_long(const char *p, size_t len)
+        {
+            const char *s = secret();
+            alignas(32) uint64_t acc[8];
+            init_acc(acc);
+
+            size_t blocks = (len - 1) / BLOCK;
+            for (size_t b = 0; b < blocks; b++)
+            {
+                for (size_t n = 0; n < STRIPES_PER_BLOCK; n++)
+                    ACC(acc, p + b * BLOCK + n * STRIPE, s + n * 8);
+                SCRAMBLE(acc, s + SECRET_SIZE - STRIPE);
+            }
+
+            // partial last block, then the final stripe (may overlap)
+            size_t stripes = ((len - 1) - BLOCK * blocks) / STRIPE;
+            for (size_t n = 0; n < stripes; n++)
+                ACC(acc, p + blocks * BLOCK + n * STRIPE, s + n * 8);
+            ACC(acc, p + len - STRIPE, s + SECRET_SIZE - STRIPE - 7);
+            return merge(acc, len);
+        }
+
+        // streaming: n whole stripes, `done` counts stripes already in the
+        // current block and the accumulators are scrambled when a block fills
+        template <void (*ACC)(uint64_t *, const char *, const char *), void (*SCRAMBLE)(uint64_t *, const char *)>
+        __attribute__((always_inline)) inline void consume(uint64_t *acc, const char *p, size_t n, size_t &done)
+        {
+            const char *s = secret();
+            for (size_t i = 0; i < n; i++)
+            {
+                ACC(acc, p + i * STRIPE, s + done * 8);
+                if (++done == STRIPES_PER_BLOCK)
+                {
+                    SCRAMBLE(acc, s + SECRET_SIZE - STRIPE);
+                    done = 0;
+                }
+            }
+        }
+
+        // one copy per instruction set, so the stripe loop inlines
+        inline uint64_t long_scalar(const char *p, size_t len)
+        {
+            return hash_long<accumulate_scalar, scramble_scalar>(p, len);
+        }
+
+        inline void consume_scalar(uint64_t *acc, const char *p, size_t n, size_t &done)
+        {
+            consume<accumulate_scalar, scramble_scalar>(acc, p, n, done);
+        }
+
+#if defined(__x86_64__)
+        __attribute__((target("sse2"))) inline uint64_t long_sse2(const char *p, size_t len)
+        {
+            return hash_long<accumulate_sse2, scramble_sse2>(p, len);
+        }
+
+        __attribute__((target("sse2"))) inline void consume_sse2(uint64_t *acc, const char *p, size_t n, size_t &done)
+        {
+            consume<accumulate_sse2, scramble_sse2>(acc, p, n, done);
+        }
+
+        __attribute__((target("avx2"))) inline uint64_t long_avx2(const char *p, size_t len)
+        {
+            return hash_long<accumulate_avx2, scramble_avx2>(p, len);
+        }
+
+        __attribute__((target("avx2"))) inline void consume_avx2(uint64_t *acc, const char *p, size_t n, size_t &done)
+        {
+            consume<accumulate_avx2, scramble_avx2>(acc, p, n, done);
+        }
+#endif
+
+        typedef uint64_t (*LongFn)(const char *, size_t);
+        typedef void (*ConsumeFn)(uint64_t *, const char *, size_t, size_t &);
+
+        struct Path
+        {
+            const char *name;
+            LongFn fn;
+            ConsumeFn consume;
+        };
+
+        // widest instruction set this cpu has, checked once
+        inline const Path &best_path()
+        {
+            static const Path path = []
+            {
+#if defined(__x86_64__)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2"))
+                    return Path{"avx2", long_avx2, consume_avx2};
+                return Path{"sse2", long_sse2, consume_sse2};
+#else
+                return Path{"scalar", long_scalar, consume_scalar};
+#endif
+            }();
+            return path;
+        }
+    }
+
+    // "avx2", "sse2" or "scalar"
+    inline const char *xxh3_path() { return XXH::best_path().name; }
+
+    inline uint64_t xxh3(const char *p, size_t len)
+    {
+        if (len <= 16)
+            return XXH::len_0to16(p, len);
+        if (len <= 128)
+            return XXH::len_17to128(p, len);
+        if (len <= 240)
+            return XXH::len_129to240(p, len);
+        return XXH::best_path().fn(p, len);
+    }
+
+    // ---- wyhash ----
+
+    namespace WY
+    {
+        const uint64_t P[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                               0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+        inline void mum(uint64_t &a, uint64_t &b)
+        {
+            unsigned __int128 r = (unsigned __int128)a * b;
+            a = (uint64_t)r;
+            b = (uint64_t)(r >> 64);
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b)
+        {
+            mum(a, b);
+            return a ^ b;
+        }
+
+        inline uint64_t read3(const char *p, size_t k)
+        {
+            return ((uint64_t)(uint8_t)p[0] << 16) | ((uint64_t)(uint8_t)p[k >> 1] << 8) | (uint8_t)p[k - 1];
+        }
+    }
+
+    inline uint64_t wyhash(const char *p, size_t len, uint64_t seed = 0)
+    {
+        using namespace WY;
+        seed ^= mix(seed ^ P[0], P[1]);
+        uint64_t a, b;
+        if (len <= 16)
+        {
+            if (len >= 4)
+            {
+                a = ((uint64_t)read32(p) << 32) | read32(p + ((len >> 3) << 2));
+                b = ((uint64_t)read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if (len > 0)
+            {
+                a = read3(p, len);
+                b = 0;
+            }
+            else
+                a = b = 0;
+        }
+        else
+        {
+            size_t i = len;
+            if (i > 48)
+            {
+                // three independent lanes per 48 bytes
+                uint64_t see1 = seed, see2 = seed;
+                do
+                {
+                    seed = mix(read64(p) ^ P[1], read64(p + 8) ^ seed);
+                    see1 = mix(read64(p + 16) ^ P[2], read64(p + 24) ^ see1);
+                    see2 = mix(read64(p + 32) ^ P[3], read64(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16)
+            {
+                seed = mix(read64(p) ^ P[1], read64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+        a ^= P[1];
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ P[0] ^ len, b ^ P[1]);
+    }
+
+    inline uint64_t hash(Algo algo, const char *p, size_t len)
+    {
+        switch (algo)
+        {
+        case XXH3:
+            return xxh3(p, len);
+        case WYHASH:
+            return wyhash(p, len);
+        default:
+            return poly31(p, len);
+        }
+    }
+
+    inline uint64_t hash(Algo algo, const string &s) { return hash(algo, s.data(), s.size()); }
+
+    // 128-bit fingerprint of a text: xxh3 and wyhash side by side
+    struct Fingerprint
+    {
+        uint64_t a, b;
+
+        bool operator==(const Fingerprint &o) const { return a == o.a && b == o.b; }
+    };
+
+    inline Fingerprint fingerprint(const char *p, size_t len)
+    {
+        return {xxh3(p, len), wyhash(p, len)};
+    }
+
+    inline Fingerprint fingerprint(const string &s) { return fingerprint(s.data(), s.size()); }
+
+    // incremental hash of input that arrives in pieces, same value as hash()
+    // on the whole input. Only a small tail is buffered: the one-shot forms
+    // treat short inputs and the last bytes specially.
+    class Stream
+    {
+    private:
+        Algo algo;
+        uint64_t total = 0;
+        uint32_t poly = 0;
+
+        // buf[keep..] not hashed yet, buf[..keep] is the hashed tail the
+        // final step reads back
+        string buf;
+        size_t keep = 0;
+
+        alignas(32) uint64_t acc[8];
+        size_t done = 0; // stripes in the current xxh3 block
+
+        uint64_t seed, see1, see2; // wyhash lanes
+
+        // drop hashed bytes, keeping the last `tail` of them
+        void compact(size_t hashed_to, size_t tail)
+        {
+            size_t from = hashed_to > tail ? hashed_to - tail : 0;
+            buf.erase(0, from);
+            keep = hashed_to - from;
+        }
+
+        void update_xxh3()
+        {
+            // up to 240 bytes the one-shot path takes the whole input
+            if (total <= 240)
+                return;
+            // a stripe is hashed once at least one byte follows it
+            size_t pending = buf.size() - keep;
+            if (pending <= XXH::STRIPE)
+                return;
+            size_t n = (pending - 1) / XXH::STRIPE;
+            XXH::best_path().consume(acc, buf.data() + keep, n, done);
+            compact(keep + n * XXH::STRIPE, XXH::STRIPE);
+        }
+
+        void update_wyhash()
+        {
+            // 48-byte blocks while more than 48 bytes remain after them
+            if (total <= 48)
+                return;
+            size_t pos = keep;
+            while (buf.size() - pos > 48)
+            {
+                const char *p = buf.data() + pos;
+                seed = WY::mix(read64(p) ^ WY::P[1], read64(p + 8) ^ seed);
+                see1 = WY::mix(read64(p + 16) ^ WY::P[2], read64(p + 24) ^ see1);
+                see2 = WY::mix(read64(p + 32) ^ WY::P[3], read64(p + 40) ^ see2);
+                pos += 48;
+            }
+            compact(pos, 16);
+        }
+
+    public:
+        explicit Stream(Algo a) : algo(a)
+        {
+            XXH::init_acc(acc);
+            seed = WY::mix(WY::P[0], WY::P[1]);
+            see1 = see2 = seed;
+        }
+
+        void update(const char *p, size_t len)
+        {
+            total += len;
+            if (algo == POLY31)
+            {
+                poly = poly31(p, len, poly);
+                return;
+            }
+            buf.append(p, len);
+            if (algo == XXH3)
+                update_xxh3();
+            else
+                update_wyhash();
+        }
+
+        uint64_t size() const { return total; }
+
+        uint64_t digest() const
+        {
+            if (algo == POLY31)
+                return poly;
+
+            if (algo == XXH3)
+            {
+                if (total <= 240)
+                    return xxh3(buf.data(), buf.size());
+                alignas(32) uint64_t a[8];
+                memcpy(a, acc, sizeof(a));
+                XXH::accumulate_scalar(a, buf.data() + buf.size() - XXH::STRIPE,
+                                       XXH::secret() + XXH::SECRET_SIZE - XXH::STRIPE - 7);
+                return XXH::merge(a, total);
+            }
+
+            if (total <= 48)
+                return wyhash(buf.data(), buf.size());
+
+            // rest of the one-shot tail: 16-byte steps, then the last 16 bytes
+            uint64_t s = seed ^ see1 ^ see2;
+            const char *p = buf.data() + keep;
+            size_t i = buf.size() - keep;
+            while (i > 16)
+            {
+                s = WY::mix(read64(p) ^ WY::P[1], read64(p + 8) ^ s);
+                i -= 16;
+                p += 16;
+            }
+            uint64_t a = read64(p + i - 16) ^ WY::P[1];
+            uint64_t b = read64(p + i - 8) ^ s;
+            WY::mum(a, b);
+            return WY::mix(a ^ WY::P[0] ^ total, b ^ WY::P[1]);
+        }
+    };
+}
+
+// 128-bit lookup key for hash_store, 32 hex chars (not cryptographic).
+// Rows stored under another format are never found again, so changing it
+// needs a TRUNCATE of hash_store (README, upgrading)
+inline string compute_text_hash(const string &text)
+{
+    Hash::Fingerprint f = Hash::fingerprint(text);
+    stringstream ss;
+    ss << hex << setfill('0') << setw(16) << f.a << setw(16) << f.b;
+    return ss.str();
+}
+
+#endif
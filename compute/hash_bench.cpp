@@ -0,0 +1,99 @@
+// Hash throughput benchmark
+// GB/s of every /compute/hash algorithm (and each xxh3 code path) over 16 B - 1 MB inputs
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <string>
+#include "hash.h"
+
+using namespace std;
+using namespace chrono;
+
+typedef uint64_t (*HashFn)(const char *, size_t);
+
+struct Candidate
+{
+    string name;
+    HashFn fn;
+};
+
+// the loop /compute/hash used before
+static uint64_t poly31_bytewise(const char *p, size_t len)
+{
+    uint32_t h = 0;
+    for (size_t i = 0; i < len; i++)
+        h = h * 31 + p[i];
+    return h;
+}
+
+static uint64_t poly31(const char *p, size_t len) { return Hash::poly31(p, len); }
+static uint64_t wyhash(const char *p, size_t len) { return Hash::wyhash(p, len); }
+
+// hash `len`-byte slices of buf for ~min_ms, return GB/s
+static double measure(HashFn fn, const vector<char> &buf, size_t len, int min_ms)
+{
+    volatile uint64_t sink = 0;
+    size_t slots = buf.size() / len;
+    long iters = 0;
+    auto start = steady_clock::now();
+    double elapsed;
+    do
+    {
+        for (int i = 0; i < 256; i++, iters++)
+            sink = sink + fn(buf.data() + (iters % slots) * len, len);
+        elapsed = duration<double>(steady_clock::now() - start).count();
+    } while (elapsed * 1000 < min_ms);
+    return (double)iters * len / elapsed / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    int min_ms = argc > 1 ? atoi(argv[1]) : 100;
+
+    // 4 MB of random bytes, larger than L2 so 1 MB inputs still stream
+    vector<char> buf(4 << 20);
+    mt19937_64 rng(42);
+    for (auto &c : buf)
+        c = (char)rng();
+
+    vector<Candidate> algos = {
+        {"poly31 (bytewise)", poly31_bytewise},
+        {"poly31", poly31},
+        {"wyhash", wyhash},
+        {"xxh3 scalar", Hash::XXH::long_scalar},
+#if defined(__x86_64__)
+        {"xxh3 sse2", Hash::XXH::long_sse2},
+#endif
+        {string("xxh3 (") + Hash::xxh3_path() + ")", Hash::xxh3},
+    };
+    vector<size_t> sizes = {16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1 << 20};
+
+    cout << "========================================\n";
+    cout << "  Hash Throughput (GB/s)\n";
+    cout << "========================================\n";
+    cout << "xxh3 dispatch: " << Hash::xxh3_path() << "\n\n";
+
+    cout << left << setw(20) << "algo";
+    for (size_t s : sizes)
+        cout << right << setw(8) << (s >= 1024 ? to_string(s / 1024) + "K" : to_string(s));
+    cout << "\n";
+
+    for (auto &a : algos)
+    {
+        cout << left << setw(20) << a.name << fixed << setprecision(2);
+        for (size_t s : sizes)
+        {
+            // the per-path xxh3 entry points only handle inputs over 240 bytes
+            if (a.name.rfind("xxh3 s", 0) == 0 && s <= 240)
+                cout << right << setw(8) << "-";
+            else
+                cout << right << setw(8) << measure(a.fn, buf, s, min_ms);
+            cout.flush();
+        }
+        cout << "\n";
+    }
+    return 0;
+}
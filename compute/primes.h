@@ -0,0 +1,93 @@
+#ifndef PRIMES_H
+#define PRIMES_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// first N primes, sieved once at startup and pre-rendered as "2,3,5,..."
+// so a "first n primes" reply is a copy of a prefix of one string
+class PrimeTable
+{
+private:
+    vector<uint32_t> primes;
+    string rendered;     // all primes, comma separated
+    vector<size_t> ends; // ends[i] = length of the list holding the first i primes
+
+    // segmented sieve of Eratosthenes, segments fit in L1/L2
+    void sieve(int count)
+    {
+        const uint32_t SEGMENT = 32768;
+
+        // grow the limit until it holds count primes (n ln n bound); 64-bit so
+        // doubling cannot wrap, primes themselves fit 32 bits for any
+        // count up to 2^31
+        uint64_t limit = 1024;
+        while (true)
+        {
+            primes.clear();
+            vector<uint32_t> base; // primes up to sqrt(limit)
+            uint32_t root = 1;
+            while ((uint64_t)root * root <= limit)
+                root++;
+            vector<bool> small(root + 1, true);
+            for (uint32_t i = 2; i <= root; i++)
+            {
+                if (!small[i])
+                    continue;
+                base.push_back(i);
+                for (uint64_t j = (uint64_t)i * i; j <= root; j += i)
+                    small[j] = false;
+            }
+
+            vector<char> seg(SEGMENT);
+            for (uint64_t lo = 2; lo <= limit && (int)primes.size() < count; lo += SEGMENT)
+            {
+                uint64_t hi = min<uint64_t>(lo + SEGMENT - 1, limit);
+                fill(seg.begin(), seg.end(), 1);
+                for (uint32_t p : base)
+                {
+                    uint64_t start = max<uint64_t>((uint64_t)p * p, ((lo + p - 1) / p) * (uint64_t)p);
+                    for (uint64_t j = start; j <= hi; j += p)
+                        seg[j - lo] = 0;
+                }
+                for (uint64_t n = lo; n <= hi && (int)primes.size() < count; n++)
+                {
+                    if (seg[n - lo])
+                        primes.push_back((uint32_t)n);
+                }
+            }
+
+            if ((int)primes.size() >= count)
+                return;
+            limit *= 2;
+        }
+    }
+
+public:
+    PrimeTable(int count)
+    {
+        sieve(count);
+
+        ends.reserve(primes.size() + 1);
+        ends.push_back(0);
+        for (size_t i = 0; i < primes.size(); i++)
+        {
+            if (i > 0)
+                rendered += ",";
+            rendered += to_string(primes[i]);
+            ends.push_back(rendered.size());
+        }
+    }
+
+    int size() { return primes.size(); }
+    uint32_t nth(int i) { return primes[i]; } // 0-based
+
+    // append "2,3,5,..." for the first n primes (n <= size())
+    void append_first(int n, string &out) { out.append(rendered, 0, ends[n]); }
+};
+
+#endif
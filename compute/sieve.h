@@ -0,0 +1,292 @@
+#ifndef SIEVE_H
+#define SIEVE_H
+
+#include <vector>
+#include <future>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "../server/executor.h"
+
+using namespace std;
+
+// prime queries beyond the startup table:
+//  - deterministic Miller-Rabin for any 64-bit n
+//  - counting / listing primes in [a, b] and the nth prime with a segmented
+//    sieve over odd numbers only, one bit per odd, segments sized for L1/L2,
+//    large spans split across the compute pool
+class PrimeSieve
+{
+public:
+    static const uint64_t MAX_VALUE = 100000000000000ULL; // 1e14, base primes up to 1e7
+
+private:
+    static const uint64_t SEGMENT_BITS = 32768 * 8; // 32 KB of bits = 512K numbers
+    static const uint64_t CHUNK = 1ULL << 24;        // smallest span worth a pool job
+
+    vector<uint32_t> base; // odd primes up to sqrt(MAX_VALUE)
+
+    static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m)
+    {
+        return (unsigned __int128)a * b % m;
+    }
+
+    static uint64_t powmod(uint64_t a, uint64_t e, uint64_t m)
+    {
+        uint64_t r = 1;
+        a %= m;
+        while (e)
+        {
+            if (e & 1)
+                r = mulmod(r, a, m);
+            a = mulmod(a, a, m);
+            e >>= 1;
+        }
+        return r;
+    }
+
+    // run fn(seg_lo, bits, n_bits) for each segment of [lo, hi];
+    // bit i set means seg_lo + 2i is prime. lo is odd and >= 3.
+    // fn returns false to stop early.
+    template <typename F>
+    void segments(uint64_t lo, uint64_t hi, F fn) const
+    {
+        vector<uint64_t> bits(SEGMENT_BITS / 64);
+        for (uint64_t seg_lo = lo; seg_lo <= hi; seg_lo += 2 * SEGMENT_BITS)
+        {
+            uint64_t seg_hi = min(hi, seg_lo + 2 * SEGMENT_BITS - 1);
+            uint64_t n_bits = (seg_hi - seg_lo) / 2 + 1;
+            fill(bits.begin(), bits.end(), ~0ULL);
+
+            for (uint32_t p : base)
+            {
+                uint64_t sq = (uint64_t)p * p;
+                if (sq > seg_hi)
+                    break;
+                // first odd multiple of p in the segment, not below p^2
+                uint64_t start = max(sq, (seg_lo + p - 1) / p * p);
+                if (start % 2 == 0)
+                    start += p;
+                for (uint64_t j = (start - seg_lo) / 2; j < n_bits; j += p)
+                    bits[j >> 6] &= ~(1ULL << (j & 63));
+            }
+
+            if (!fn(seg_lo, bits, n_bits))
+                return;
+        }
+    }
+
+    // primes in [lo, hi] on the calling thread
+    uint64_t count_serial(uint64_t lo, uint64_t hi) const
+    {
+        uint64_t total = (lo <= 2 && hi >= 2) ? 1 : 0;
+        lo = max<uint64_t>(lo, 3) | 1;
+        if (lo > hi)
+            return total;
+
+        segments(lo, hi, [&](uint64_t, const vector<uint64_t> &bits, uint64_t n_bits)
+                 {
+            uint64_t full = n_bits / 64;
+            for (uint64_t w = 0; w < full; w++)
+                total += __builtin_popcountll(bits[w]);
+            if (n_bits % 64)
+                total += __builtin_popcountll(bits[full] & ((1ULL << (n_bits % 64)) - 1));
+            return true; });
+        return total;
+    }
+
+    // kth prime (1-based) in [lo, hi] on the calling thread, 0 if there are
+    // fewer; counts a word at a time and only picks out bits in the last one
+    uint64_t kth_serial(uint64_t lo, uint64_t hi, uint64_t k) const
+    {
+        if (lo <= 2 && hi >= 2 && --k == 0)
+            return 2;
+        lo = max<uint64_t>(lo, 3) | 1;
+        if (lo > hi || k == 0)
+            return 0;
+
+        uint64_t found = 0;
+        segments(lo, hi, [&](uint64_t seg_lo, const vector<uint64_t> &bits, uint64_t n_bits)
+                 {
+            for (uint64_t w = 0; w * 64 < n_bits; w++) {
+                uint64_t word = bits[w];
+                if ((w + 1) * 64 > n_bits)
+                    word &= (1ULL << (n_bits % 64)) - 1;
+                uint64_t c = __builtin_popcountll(word);
+                if (c < k) {
+                    k -= c;
+                    continue;
+                }
+                while (--k)
+                    word &= word - 1; // drop the lowest set bit
+                found = seg_lo + 2 * (w * 64 + __builtin_ctzll(word));
+                return false;
+            }
+            return true; });
+        return found;
+    }
+
+    // split [lo, hi] into pool-sized chunks
+    static vector<pair<uint64_t, uint64_t>> chunks(uint64_t lo, uint64_t hi, int workers)
+    {
+        uint64_t span = hi - lo + 1;
+        uint64_t size = max(CHUNK, span / (workers * 4) + 1);
+        vector<pair<uint64_t, uint64_t>> out;
+        for (uint64_t a = lo; a <= hi; a += size)
+        {
+            out.push_back({a, min(hi, a + size - 1)});
+            if (hi - a < size)
+                break;
+        }
+        return out;
+    }
+
+    // count every chunk on the pool, results in chunk order
+    vector<uint64_t> count_chunks(const vector<pair<uint64_t, uint64_t>> &parts, Executor *pool) const
+    {
+        vector<future<uint64_t>> pending;
+        for (auto &c : parts)
+        {
+            pending.push_back(pool->submit([this, c]
+                                           { return count_serial(c.first, c.second); }));
+        }
+        vector<uint64_t> counts;
+        for (auto &f : pending)
+            counts.push_back(f.get());
+        return counts;
+    }
+
+public:
+    PrimeSieve()
+    {
+        uint32_t limit = (uint32_t)sqrt((double)MAX_VALUE) + 1;
+        vector<bool> composite(limit + 1, false);
+        for (uint32_t i = 3; i <= limit; i += 2)
+        {
+            if (composite[i])
+                continue;
+            base.push_back(i);
+            for (uint64_t j = (uint64_t)i * i; j <= limit; j += 2 * i)
+                composite[j] = true;
+        }
+    }
+
+    // deterministic for all 64-bit n (first 12 prime bases)
+    static bool is_prime(uint64_t n)
+    {
+        if (n < 2)
+            return false;
+        static const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+        for (uint64_t p : bases)
+        {
+            if (n % p == 0)
+                return n == p;
+        }
+
+        uint64_t d = n - 1;
+        int s = 0;
+        while ((d & 1) == 0)
+        {
+            d >>= 1;
+            s++;
+        }
+
+        for (uint64_t a : bases)
+        {
+            uint64_t x = powmod(a, d, n);
+            if (x == 1 || x == n - 1)
+                continue;
+            bool composite = true;
+            for (int r = 1; r < s && composite; r++)
+            {
+                x = mulmod(x, x, n);
+                if (x == n - 1)
+                    composite = false;
+            }
+            if (composite)
+                return false;
+        }
+        return true;
+    }
+
+    // number of primes in [lo, hi], hi <= MAX_VALUE
+    uint64_t count(uint64_t lo, uint64_t hi, Executor *pool) const
+    {
+        if (lo > hi)
+            return 0;
+        auto parts = chunks(lo, hi, pool->size());
+        if (parts.size() == 1)
+            return count_serial(lo, hi);
+
+        uint64_t total = 0;
+        for (uint64_t c : count_chunks(parts, pool))
+            total += c;
+        return total;
+    }
+
+    // first `max_count` primes in [lo, hi], on the calling thread
+    vector<uint64_t> list(uint64_t lo, uint64_t hi, size_t max_count) const
+    {
+        vector<uint64_t> out;
+        if (lo <= 2 && hi >= 2 && max_count > 0)
+            out.push_back(2);
+        lo = max<uint64_t>(lo, 3) | 1;
+        if (lo > hi || out.size() >= max_count)
+            return out;
+
+        segments(lo, hi, [&](uint64_t seg_lo, const vector<uint64_t> &bits, uint64_t n_bits)
+                 {
+            for (uint64_t i = 0; i < n_bits; i++) {
+                if ((bits[i >> 6] >> (i & 63)) & 1) {
+                    out.push_back(seg_lo + 2 * i);
+                    if (out.size() >= max_count) return false;
+                }
+            }
+            return true; });
+        return out;
+    }
+
+    // upper bound on the nth prime, p_n < n (ln n + ln ln n) for n >= 6
+    static uint64_t nth_bound(uint64_t n)
+    {
+        if (n < 6)
+            return 13;
+        double ln = log((double)n);
+        double bound = n * (ln + log(ln)) + 1;
+        return bound > (double)MAX_VALUE ? MAX_VALUE + 1 : (uint64_t)bound;
+    }
+
+    // nth prime (1-based), 0 if it lies beyond MAX_VALUE
+    uint64_t nth(uint64_t n, Executor *pool) const
+    {
+        if (n == 0)
+            return 0;
+        if (n < 6)
+            return vector<uint64_t>{2, 3, 5, 7, 11}[n - 1];
+
+        uint64_t bound = nth_bound(n);
+        if (bound > MAX_VALUE)
+            return 0;
+
+        // count chunks in parallel and narrow down to the chunk holding p_n,
+        // splitting it again until it is one job, then find it in there
+        uint64_t lo = 2, hi = bound;
+        for (;;)
+        {
+            auto parts = chunks(lo, hi, pool->size());
+            if (parts.size() == 1)
+                return kth_serial(lo, hi, n);
+
+            auto counts = count_chunks(parts, pool);
+            size_t i = 0;
+            while (i < parts.size() && counts[i] < n)
+                n -= counts[i++];
+            if (i == parts.size())
+                return 0;
+            lo = parts[i].first;
+            hi = parts[i].second;
+        }
+    }
+};
+
+#endif
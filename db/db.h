@@ -4,36 +4,74 @@
 #include <mysql/mysql.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 #include "../include/config.h"
+#include "../include/metrics.h"
+#include "../include/profile.h"
+#include "../compute/hash.h"
 
 using namespace std;
 
-// helper function to compute SHA256-like hash for text (simple version)
-inline string compute_text_hash(const string &text)
-{
-    // Simple hash function (not cryptographic, but sufficient for DB key)
-    uint64_t h1 = 0, h2 = 0;
-    for (size_t i = 0; i < text.length(); i++)
-    {
-        h1 = h1 * 31 + text[i];
-        h2 = h2 * 37 + text[i];
-    }
-    stringstream ss;
-    ss << hex << setfill('0') << setw(16) << h1 << setw(16) << h2;
-    return ss.str();
-}
-
 // database connection pool
 class DB
 {
+public:
+    enum Op
+    {
+        GET,
+        GET_MANY,
+        PUT,
+        PUT_MANY,
+        SCAN,
+        DEL,
+        GET_HASH,
+        PUT_HASH,
+        OPS
+    };
+
 private:
     vector<MYSQL *> pool;
     mutex mtx;
 
+    // /metrics: pool checkout and per-statement latency
+    LatencyHistogram pool_wait;
+    LatencyHistogram query_latency[OPS];
+    atomic<long> in_use{0};
+    atomic<long> exhausted{0}; // checkouts that found the pool empty
+    size_t pool_size = 0;
+
+    // quoted, escaped SQL string literal of any length
+    static string quote(MYSQL *conn, const string &s)
+    {
+        string esc(s.length() * 2 + 1, '\0');
+        esc.resize(mysql_real_escape_string(conn, &esc[0], s.c_str(), s.length()));
+        return "'" + esc + "'";
+    }
+
+    // run a statement, timed into query_latency[op]
+    bool run(MYSQL *conn, Op op, const string &q)
+    {
+        ProfileTimer timer(Profile::DB_QUERY);
+        auto start = chrono::steady_clock::now();
+        bool ok = mysql_query(conn, q.c_str()) == 0;
+        query_latency[op].record_since(start);
+        return ok;
+    }
+
+    // run a SELECT and fetch its rows, timed together; nullptr on failure
+    MYSQL_RES *fetch(MYSQL *conn, Op op, const string &q)
+    {
+        ProfileTimer timer(Profile::DB_QUERY);
+        auto start = chrono::steady_clock::now();
+        MYSQL_RES *res = mysql_query(conn, q.c_str()) == 0 ? mysql_store_result(conn) : nullptr;
+        query_latency[op].record_since(start);
+        return res;
+    }
+
 public:
     DB()
     {
@@ -61,6 +99,7 @@ public:
             pool.push_back(conn);
         }
 
+        pool_size = pool.size();
         cout << "DB pool created: " << pool.size() << " connections\n";
     }
 
@@ -75,11 +114,18 @@ public:
     // get connection from pool
     MYSQL *get_conn()
     {
+        ProfileTimer timer(Profile::DB_POOL);
+        auto start = chrono::steady_clock::now();
         lock_guard<mutex> lock(mtx);
+        pool_wait.record_since(start);
         if (pool.empty())
+        {
+            exhausted.fetch_add(1, memory_order_relaxed);
             return nullptr;
+        }
         MYSQL *conn = pool.back();
         pool.pop_back();
+        in_use.fetch_add(1, memory_order_relaxed);
         return conn;
     }
 
@@ -88,10 +134,32 @@ public:
     {
         if (!conn)
             return;
+        in_use.fetch_sub(1, memory_order_relaxed);
         lock_guard<mutex> lock(mtx);
         pool.push_back(conn);
     }
 
+    // pool and query metrics in Prometheus text format
+    void write_metrics(string &out)
+    {
+        static const char *ops[] = {"get", "get_many", "put", "put_many", "scan", "del", "get_hash", "put_hash"};
+
+        Metrics::family(out, "kv_db_pool_connections", "gauge", "Connections in the DB pool.");
+        Metrics::sample(out, "kv_db_pool_connections", "", pool_size);
+        Metrics::family(out, "kv_db_pool_in_use", "gauge", "DB connections checked out.");
+        Metrics::sample(out, "kv_db_pool_in_use", "", in_use.load(memory_order_relaxed));
+        Metrics::family(out, "kv_db_pool_exhausted_total", "counter", "Checkouts that found no free DB connection.");
+        Metrics::sample(out, "kv_db_pool_exhausted_total", "", exhausted.load(memory_order_relaxed));
+        Metrics::family(out, "kv_db_pool_wait_seconds", "histogram", "Time to check a connection out of the DB pool.");
+        pool_wait.write(out, "kv_db_pool_wait_seconds", "");
+        Metrics::family(out, "kv_db_query_duration_seconds", "histogram", "DB statement latency, rows fetched included, by operation.");
+        for (int op = 0; op < OPS; op++)
+        {
+            if (query_latency[op].count())
+                query_latency[op].write(out, "kv_db_query_duration_seconds", "op=\"" + string(ops[op]) + "\"");
+        }
+    }
+
     // insert or update
     bool put(const string &key, const string &val)
     {
@@ -99,15 +167,11 @@ public:
         if (!conn)
             return false;
 
-        char esc_key[512], esc_val[1024];
-        mysql_real_escape_string(conn, esc_key, key.c_str(), key.length());
-        mysql_real_escape_string(conn, esc_val, val.c_str(), val.length());
+        string query = "INSERT INTO kv_pairs (kv_key, kv_value) VALUES (" +
+                       quote(conn, key) + ", " + quote(conn, val) +
+                       ") ON DUPLICATE KEY UPDATE kv_value=VALUES(kv_value)";
 
-        string query = "INSERT INTO kv_pairs (kv_key, kv_value) VALUES ('" +
-                       string(esc_key) + "', '" + string(esc_val) +
-                       "') ON DUPLICATE KEY UPDATE kv_value='" + string(esc_val) + "'";
-
-        bool ok = mysql_query(conn, query.c_str()) == 0;
+        bool ok = run(conn, PUT, query);
         return_conn(conn);
         return ok;
     }
@@ -119,32 +183,129 @@ public:
         if (!conn)
             return false;
 
-        char esc_key[512];
-        mysql_real_escape_string(conn, esc_key, key.c_str(), key.length());
-
-        string query = "SELECT kv_value FROM kv_pairs WHERE kv_key='" +
-                       string(esc_key) + "'";
+        string query = "SELECT kv_value FROM kv_pairs WHERE kv_key=" + quote(conn, key);
 
         bool found = false;
-        if (mysql_query(conn, query.c_str()) == 0)
+        MYSQL_RES *res = fetch(conn, GET, query);
+        if (res)
         {
-            MYSQL_RES *res = mysql_store_result(conn);
-            if (res)
+            MYSQL_ROW row = mysql_fetch_row(res);
+            if (row && row[0])
             {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row && row[0])
-                {
-                    val = row[0];
-                    found = true;
-                }
-                mysql_free_result(res);
+                val = row[0];
+                found = true;
             }
+            mysql_free_result(res);
         }
 
         return_conn(conn);
         return found;
     }
 
+    // get several keys with one query, found pairs go into vals
+    bool get_many(const vector<string> &keys, unordered_map<string, string> &vals)
+    {
+        if (keys.empty())
+            return true;
+
+        MYSQL *conn = get_conn();
+        if (!conn)
+            return false;
+
+        string query = "SELECT kv_key, kv_value FROM kv_pairs WHERE kv_key IN (";
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (i > 0)
+                query += ",";
+            query += quote(conn, keys[i]);
+        }
+        query += ")";
+
+        bool ok = false;
+        MYSQL_RES *res = fetch(conn, GET_MANY, query);
+        if (res)
+        {
+            MYSQL_ROW row;
+            while ((row = mysql_fetch_row(res)))
+            {
+                if (row[0] && row[1])
+                    vals[row[0]] = row[1];
+            }
+            mysql_free_result(res);
+            ok = true;
+        }
+
+        return_conn(conn);
+        return ok;
+    }
+
+    // insert or update several pairs with one multi-row insert
+    bool put_many(const vector<pair<string, string>> &kvs)
+    {
+        if (kvs.empty())
+            return true;
+
+        MYSQL *conn = get_conn();
+        if (!conn)
+            return false;
+
+        string query = "INSERT INTO kv_pairs (kv_key, kv_value) VALUES ";
+        for (size_t i = 0; i < kvs.size(); i++)
+        {
+            if (i > 0)
+                query += ",";
+            query += "(" + quote(conn, kvs[i].first) + "," + quote(conn, kvs[i].second) + ")";
+        }
+        query += " ON DUPLICATE KEY UPDATE kv_value=VALUES(kv_value)";
+
+        bool ok = run(conn, PUT_MANY, query);
+        return_conn(conn);
+        return ok;
+    }
+
+    // one page of a key-ordered scan (keyset pagination on the primary key):
+    // keys starting with prefix, from start (inclusive) or after `after`
+    bool scan(const string &prefix, const string &start, const string &after,
+              int limit, vector<pair<string, string>> &rows)
+    {
+        MYSQL *conn = get_conn();
+        if (!conn)
+            return false;
+
+        // escape LIKE wildcards in the prefix
+        string like;
+        for (char c : prefix)
+        {
+            if (c == '%' || c == '_' || c == '\\')
+                like += '\\';
+            like += c;
+        }
+
+        string query = "SELECT kv_key, kv_value FROM kv_pairs WHERE kv_key LIKE " + quote(conn, like + "%");
+        if (!after.empty())
+            query += " AND kv_key > " + quote(conn, after);
+        else if (!start.empty() || !prefix.empty())
+            query += " AND kv_key >= " + quote(conn, max(start, prefix));
+        query += " ORDER BY kv_key LIMIT " + to_string(limit);
+
+        bool ok = false;
+        MYSQL_RES *res = fetch(conn, SCAN, query);
+        if (res)
+        {
+            MYSQL_ROW row;
+            while ((row = mysql_fetch_row(res)))
+            {
+                if (row[0])
+                    rows.push_back({row[0], row[1] ? row[1] : ""});
+            }
+            mysql_free_result(res);
+            ok = true;
+        }
+
+        return_conn(conn);
+        return ok;
+    }
+
     // delete by key
     bool del(const string &key)
     {
@@ -152,12 +313,9 @@ public:
         if (!conn)
             return false;
 
-        char esc_key[512];
-        mysql_real_escape_string(conn, esc_key, key.c_str(), key.length());
-
-        string query = "DELETE FROM kv_pairs WHERE kv_key='" + string(esc_key) + "'";
+        string query = "DELETE FROM kv_pairs WHERE kv_key=" + quote(conn, key);
 
-        bool ok = mysql_query(conn, query.c_str()) == 0;
+        bool ok = run(conn, DEL, query);
         return_conn(conn);
         return ok;
     }
@@ -175,16 +333,11 @@ public:
         // Get text prefix (first 255 chars)
         string text_prefix = text.substr(0, 255);
 
-        char esc_text[4096];
-        char esc_prefix[512];
-        mysql_real_escape_string(conn, esc_text, text.c_str(), text.length());
-        mysql_real_escape_string(conn, esc_prefix, text_prefix.c_str(), text_prefix.length());
-
-        string query = "INSERT INTO hash_store (text_prefix, text_hash, text, hash_value) VALUES ('" +
-                       string(esc_prefix) + "', '" + text_hash + "', '" + string(esc_text) + "', " + to_string(hash) +
+        string query = "INSERT INTO hash_store (text_prefix, text_hash, text, hash_value) VALUES (" +
+                       quote(conn, text_prefix) + ", '" + text_hash + "', " + quote(conn, text) + ", " + to_string(hash) +
                        ") ON DUPLICATE KEY UPDATE hash_value=" + to_string(hash);
 
-        bool ok = mysql_query(conn, query.c_str()) == 0;
+        bool ok = run(conn, PUT_HASH, query);
         return_conn(conn);
         return ok;
     }
@@ -200,30 +353,22 @@ public:
         string text_hash = compute_text_hash(text);
         string text_prefix = text.substr(0, 255);
 
-        char esc_text[4096];
-        char esc_prefix[512];
-        mysql_real_escape_string(conn, esc_text, text.c_str(), text.length());
-        mysql_real_escape_string(conn, esc_prefix, text_prefix.c_str(), text_prefix.length());
-
         // Query uses hash for fast filtering, then exact text match to handle collisions
-        string query = "SELECT hash_value FROM hash_store WHERE text_prefix='" +
-                       string(esc_prefix) + "' AND text_hash='" + text_hash +
-                       "' AND text='" + string(esc_text) + "'";
+        string query = "SELECT hash_value FROM hash_store WHERE text_prefix=" +
+                       quote(conn, text_prefix) + " AND text_hash='" + text_hash +
+                       "' AND text=" + quote(conn, text);
 
         bool found = false;
-        if (mysql_query(conn, query.c_str()) == 0)
+        MYSQL_RES *res = fetch(conn, GET_HASH, query);
+        if (res)
         {
-            MYSQL_RES *res = mysql_store_result(conn);
-            if (res)
+            MYSQL_ROW row = mysql_fetch_row(res);
+            if (row && row[0])
             {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row && row[0])
-                {
-                    hash = stoul(row[0]);
-                    found = true;
-                }
-                mysql_free_result(res);
+                hash = stoul(row[0]);
+                found = true;
             }
+            mysql_free_result(res);
         }
 
         return_conn(conn);
@@ -4,21 +4,53 @@
 #include <string>
 
 // basic config stuff
+// defaults below, overridable at startup (see config_loader.h)
 namespace Config
 {
-    const std::string HOST = "0.0.0.0";
-    const int PORT = 8080;
-    const int THREADS = 8;
-
-    const std::string DB_HOST = "localhost";
-    const int DB_PORT = 3306;
-    const std::string DB_USER = "root";
-    const std::string DB_PASS = "";
-    const std::string DB_NAME = "kvstore_db";
-    const int DB_POOL = 10;
-
-    const int CACHE_SIZE = 1000;
-    const int HASH_CACHE_SIZE = 500; // separate cache for hash computations
+    inline std::string HOST = "0.0.0.0";
+    inline int PORT = 8080;
+    inline int IO_THREADS = 32;     // connection workers (kv and db routes)
+    inline int COMPUTE_THREADS = 0; // CPU-bound routes, 0 = one per core
+    inline int BINARY_PORT = 9090;  // binary kv protocol, 0 = disabled
+    inline int BINARY_THREADS = 16; // binary protocol connection workers
+    inline int PIPELINE_PORT = 8081;  // pipelined HTTP/1.1 for /kv routes, 0 = disabled
+    inline int PIPELINE_THREADS = 16; // pipelined HTTP connection workers
+    inline int IDLE_TIMEOUT_S = 5;    // binary / pipelined: close connections idle this long
+    inline int READ_TIMEOUT_S = 10;   // binary / pipelined: time to finish sending a started request
+
+    // admission control: 503 + Retry-After instead of unbounded queueing
+    inline int IO_QUEUE_LIMIT = 256;     // shed when this many connections wait
+    inline int IO_QUEUE_MAX = 1024;      // hard cap, extra connections are closed
+    inline int COMPUTE_QUEUE_LIMIT = 64; // shed compute requests beyond this
+    inline int SHED_TARGET_MS = 5;       // CoDel target queue wait
+    inline int SHED_INTERVAL_MS = 100;   // CoDel interval
+    inline int RETRY_AFTER_S = 1;
+
+    inline std::string DB_HOST = "localhost";
+    inline int DB_PORT = 3306;
+    inline std::string DB_USER = "root";
+    inline std::string DB_PASS = "";
+    inline std::string DB_NAME = "kvstore_db";
+    inline int DB_POOL = 10;
+
+    inline int MAX_PRIMES = 10000; // /compute/prime table, sieved at startup (up to 10M)
+    inline int SIEVE_MAX_SPAN = 1000000000; // widest /compute/primes range
+    inline int PRIME_LIST_MAX = 10000;      // primes listed per /compute/primes reply
+
+    inline int MAX_BATCH = 1000;   // keys per /kv/mget or /kv/mput request
+    inline int BULK_BATCH = 1000;  // rows per db insert in /kv/bulk_load
+    inline int SCAN_PAGE = 500;    // rows fetched per /kv/scan db query
+    inline int SCAN_MAX = 100000;  // largest /kv/scan limit
+
+    inline int CACHE_SIZE = 1000;
+    inline int HASH_CACHE_SIZE = 500; // /compute/hash results, keyed by 128-bit text fingerprint
+    inline int HASH_COST_PROBE = 100; // skipped hash tiers still checked 1 in N requests (0 = never)
+
+    inline std::string TRACE_FILE = ""; // binary request trace for load generator replay, "" = off
+    inline int TRACE_BUFFER = 65536;    // records buffered between writes to the trace file
+
+    inline int PROFILE = 0;                // per-stage profiling from startup (/admin/profile toggles it)
+    inline std::string PROFILE_ROUTE = ""; // profile only this route (kv_read, ...), "" = all
 }
 
 #endif
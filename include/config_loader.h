@@ -0,0 +1,226 @@
+#ifndef CONFIG_LOADER_H
+#define CONFIG_LOADER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
+#include "config.h"
+
+// runtime config: defaults < config file < KV_* env vars < command line
+//
+//   config file:  io_threads = 16      (# starts a comment)
+//   env:          KV_IO_THREADS=16
+//   cli:          --io-threads 16  or  --io-threads=16
+namespace Config
+{
+    struct Option
+    {
+        std::string name; // file key, e.g. "io_threads"
+        int *num;         // exactly one of num / str is set
+        std::string *str;
+        int min = 0;      // accepted range for num
+        int max = INT_MAX;
+    };
+
+    inline std::vector<Option> options()
+    {
+        return {
+            {"host", nullptr, &HOST},
+            {"port", &PORT, nullptr, 1, 65535},
+            {"io_threads", &IO_THREADS, nullptr, 1},
+            {"compute_threads", &COMPUTE_THREADS, nullptr, 0},
+            {"binary_port", &BINARY_PORT, nullptr, 0, 65535},
+            {"binary_threads", &BINARY_THREADS, nullptr, 1},
+            {"pipeline_port", &PIPELINE_PORT, nullptr, 0, 65535},
+            {"pipeline_threads", &PIPELINE_THREADS, nullptr, 1},
+            {"idle_timeout_s", &IDLE_TIMEOUT_S, nullptr, 1},
+            {"read_timeout_s", &READ_TIMEOUT_S, nullptr, 1},
+            {"io_queue_limit", &IO_QUEUE_LIMIT, nullptr, 1},
+            {"io_queue_max", &IO_QUEUE_MAX, nullptr, 1},
+            {"compute_queue_limit", &COMPUTE_QUEUE_LIMIT, nullptr, 1},
+            {"shed_target_ms", &SHED_TARGET_MS, nullptr, 1},
+            {"shed_interval_ms", &SHED_INTERVAL_MS, nullptr, 1},
+            {"retry_after_s", &RETRY_AFTER_S, nullptr, 0},
+            {"db_host", nullptr, &DB_HOST},
+            {"db_port", &DB_PORT, nullptr, 1, 65535},
+            {"db_user", nullptr, &DB_USER},
+            {"db_pass", nullptr, &DB_PASS},
+            {"db_name", nullptr, &DB_NAME},
+            {"db_pool", &DB_POOL, nullptr, 1},
+            {"max_primes", &MAX_PRIMES, nullptr, 1, 10000000},
+            {"sieve_max_span", &SIEVE_MAX_SPAN, nullptr, 1},
+            {"prime_list_max", &PRIME_LIST_MAX, nullptr, 1},
+            {"max_batch", &MAX_BATCH, nullptr, 1},
+            {"bulk_batch", &BULK_BATCH, nullptr, 1},
+            {"scan_page", &SCAN_PAGE, nullptr, 1},
+            {"scan_max", &SCAN_MAX, nullptr, 1},
+            {"cache_size", &CACHE_SIZE, nullptr, 1},
+            {"hash_cache_size", &HASH_CACHE_SIZE, nullptr, 1},
+            {"hash_cost_probe", &HASH_COST_PROBE, nullptr, 0},
+            {"trace_file", nullptr, &TRACE_FILE},
+            {"trace_buffer", &TRACE_BUFFER, nullptr, 1},
+            {"profile", &PROFILE, nullptr, 0, 1},
+            {"profile_route", nullptr, &PROFILE_ROUTE},
+        };
+    }
+
+    inline std::string trim(const std::string &s)
+    {
+        size_t b = s.find_first_not_of(" \t\r");
+        if (b == std::string::npos)
+            return "";
+        size_t e = s.find_last_not_of(" \t\r");
+        return s.substr(b, e - b + 1);
+    }
+
+    // set one option by name, "io-threads" and "io_threads" both work
+    inline bool set(std::string name, const std::string &value, const std::string &from)
+    {
+        std::replace(name.begin(), name.end(), '-', '_');
+        for (auto &opt : options())
+        {
+            if (opt.name != name)
+                continue;
+            if (opt.str)
+            {
+                *opt.str = value;
+                return true;
+            }
+            int n;
+            try
+            {
+                size_t pos;
+                n = std::stoi(value, &pos);
+                if (pos != value.size())
+                    throw std::invalid_argument(value);
+            }
+            catch (const std::exception &)
+            {
+                std::cerr << from << ": bad number for " << name << ": '" << value << "'\n";
+                return false;
+            }
+            if (n < opt.min || n > opt.max)
+            {
+                std::cerr << from << ": " << name << " must be " << opt.min
+                          << (opt.max == INT_MAX ? " or more" : "-" + std::to_string(opt.max)) << ", got " << n << "\n";
+                return false;
+            }
+            *opt.num = n;
+            return true;
+        }
+        std::cerr << from << ": unknown option '" << name << "'\n";
+        return false;
+    }
+
+    inline bool load_file(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cerr << "Cannot open config file: " << path << "\n";
+            return false;
+        }
+
+        std::string line;
+        int line_no = 0;
+        bool ok = true;
+        while (std::getline(in, line))
+        {
+            line_no++;
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty())
+                continue;
+
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+            {
+                std::cerr << path << ":" << line_no << ": expected key = value\n";
+                ok = false;
+                continue;
+            }
+            std::string where = path + ":" + std::to_string(line_no);
+            ok = set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), where) && ok;
+        }
+        return ok;
+    }
+
+    inline bool load_env()
+    {
+        bool ok = true;
+        for (auto &opt : options())
+        {
+            std::string var = "KV_" + opt.name;
+            std::transform(var.begin(), var.end(), var.begin(), ::toupper);
+            if (const char *v = std::getenv(var.c_str()))
+                ok = set(opt.name, v, var) && ok;
+        }
+        return ok;
+    }
+
+    inline void print_usage(const char *prog)
+    {
+        std::cout << "Usage: " << prog << " [--config FILE] [--option value ...]\n";
+        std::cout << "Options (also settable as KV_<OPTION> env vars or in the config file):\n";
+        for (auto &opt : options())
+        {
+            std::string flag = opt.name;
+            std::replace(flag.begin(), flag.end(), '_', '-');
+            std::cout << "  --" << flag << " (default: "
+                      << (opt.str ? *opt.str : std::to_string(*opt.num)) << ")\n";
+        }
+    }
+
+    // apply file, env and command line on top of the defaults
+    // returns false on bad input or --help
+    inline bool load(int argc, char *argv[])
+    {
+        std::string file;
+        if (const char *v = std::getenv("KV_CONFIG"))
+            file = v;
+
+        std::vector<std::pair<std::string, std::string>> cli;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg.rfind("--", 0) != 0)
+                return false;
+
+            std::string name = arg.substr(2), value;
+            size_t eq = name.find('=');
+            if (eq != std::string::npos)
+            {
+                value = name.substr(eq + 1);
+                name = name.substr(0, eq);
+            }
+            else if (i + 1 < argc)
+            {
+                value = argv[++i];
+            }
+            else
+            {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+
+            if (name == "config")
+                file = value;
+            else
+                cli.push_back({name, value});
+        }
+
+        bool ok = true;
+        if (!file.empty())
+            ok = load_file(file) && ok;
+        ok = load_env() && ok;
+        for (auto &kv : cli)
+            ok = set(kv.first, kv.second, "--" + kv.first) && ok;
+        return ok;
+    }
+}
+
+#endif
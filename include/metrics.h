@@ -0,0 +1,138 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+// Prometheus text format (version 0.0.4) for GET /metrics
+//
+// Recording never locks: every histogram keeps one cache-line aligned shard
+// per thread slot (threads take slots round robin), and a record is two
+// relaxed atomic adds on the caller's own shard. A scrape sums the shards,
+// so it sees each bucket at some recent point, never a torn one.
+namespace Metrics
+{
+    const int SHARDS = 64;
+
+    // bucket upper bounds, 100 us .. 10 s, plus +Inf
+    const int BUCKETS = 16;
+    const uint64_t BOUND_NS[BUCKETS] = {100000, 250000, 500000, 1000000, 2500000, 5000000,
+                                        10000000, 25000000, 50000000, 100000000, 250000000,
+                                        500000000, 1000000000, 2500000000, 5000000000, 10000000000};
+    const char *const LE[BUCKETS + 1] = {"0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005",
+                                         "0.01", "0.025", "0.05", "0.1", "0.25",
+                                         "0.5", "1", "2.5", "5", "10", "+Inf"};
+
+    // this thread's shard
+    inline int shard()
+    {
+        static atomic<int> next{0};
+        thread_local int id = next.fetch_add(1, memory_order_relaxed) % SHARDS;
+        return id;
+    }
+
+    inline uint64_t since_ns(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+
+    // # HELP / # TYPE lines, once per metric family
+    inline void family(string &out, const string &name, const char *type, const char *help)
+    {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " " + type + "\n";
+    }
+
+    // name{labels} value, counts written as whole numbers
+    inline void sample(string &out, const string &name, const string &labels, double value)
+    {
+        char num[32];
+        if (value > -9e15 && value < 9e15 && value == (double)(int64_t)value)
+            snprintf(num, sizeof(num), "%lld", (long long)value);
+        else
+            snprintf(num, sizeof(num), "%.9g", value);
+        out += name;
+        if (!labels.empty())
+            out += "{" + labels + "}";
+        out += " ";
+        out += num;
+        out += "\n";
+    }
+}
+
+// latency histogram with the Metrics buckets, in seconds when written
+class LatencyHistogram
+{
+private:
+    struct alignas(64) Shard
+    {
+        atomic<uint64_t> counts[Metrics::BUCKETS + 1];
+        atomic<uint64_t> sum_ns;
+    };
+
+    Shard shards[Metrics::SHARDS];
+
+public:
+    LatencyHistogram()
+    {
+        for (auto &s : shards)
+        {
+            for (auto &c : s.counts)
+                c.store(0, memory_order_relaxed);
+            s.sum_ns.store(0, memory_order_relaxed);
+        }
+    }
+
+    void record_ns(uint64_t ns)
+    {
+        int b = 0;
+        while (b < Metrics::BUCKETS && ns > Metrics::BOUND_NS[b])
+            b++;
+        Shard &s = shards[Metrics::shard()];
+        s.counts[b].fetch_add(1, memory_order_relaxed);
+        s.sum_ns.fetch_add(ns, memory_order_relaxed);
+    }
+
+    void record_since(chrono::steady_clock::time_point start) { record_ns(Metrics::since_ns(start)); }
+
+    uint64_t count() const
+    {
+        uint64_t n = 0;
+        for (auto &s : shards)
+        {
+            for (auto &c : s.counts)
+                n += c.load(memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // name_bucket (cumulative), name_sum and name_count samples
+    void write(string &out, const string &name, const string &labels) const
+    {
+        uint64_t buckets[Metrics::BUCKETS + 1] = {};
+        uint64_t sum_ns = 0;
+        for (auto &s : shards)
+        {
+            for (int b = 0; b <= Metrics::BUCKETS; b++)
+                buckets[b] += s.counts[b].load(memory_order_relaxed);
+            sum_ns += s.sum_ns.load(memory_order_relaxed);
+        }
+
+        string sep = labels.empty() ? "" : labels + ",";
+        uint64_t total = 0;
+        for (int b = 0; b <= Metrics::BUCKETS; b++)
+        {
+            total += buckets[b];
+            Metrics::sample(out, name + "_bucket", sep + "le=\"" + Metrics::LE[b] + "\"", total);
+        }
+        Metrics::sample(out, name + "_sum", labels, sum_ns / 1e9);
+        Metrics::sample(out, name + "_count", labels, total);
+    }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include "metrics.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+// per-stage request profiling, switched on and off at runtime (POST
+// /admin/profile, or the profile option at startup)
+//
+// The pre-routing handler decides whether the request on this thread is
+// profiled and keeps that in a thread_local; a ProfileTimer only reads the
+// TSC when it is set, so with profiling off a timer costs one thread_local
+// test. Stages from the binary and pipelined listeners are not profiled.
+//
+// Each stage has a log-linear histogram (4 buckets per power of two, so
+// percentiles are within ~20%) sharded per thread like metrics.h, in
+// static storage that stays untouched until profiling is first enabled.
+namespace Profile
+{
+    enum Stage
+    {
+        HTTP_PARSE, // request line read to routing: headers and query string
+        ADMISSION,  // pre-routing: trace record and admission decision
+        CACHE,      // cache calls from handlers, lock wait included
+        CACHE_LOCK, // waiting for a cache mutex (within cache)
+        DB_POOL,    // db connection checkout
+        DB_QUERY,   // db statement round trip, rows fetched
+        COMPUTE,    // hashing and sieving
+        JSON,       // response body building
+        REQUEST,    // routing to response headers, the whole request
+        STAGES
+    };
+
+    inline const char *name(int s)
+    {
+        static const char *names[] = {"http_parse", "admission", "cache", "cache_lock", "db_pool",
+                                      "db_query", "compute", "json", "request"};
+        return names[s];
+    }
+
+    const int SUB = 4;
+    const int BUCKETS = 40 * SUB; // up to 2^40 ns (~18 minutes)
+    const int SHARDS = 16;
+
+    struct alignas(64) Shard
+    {
+        atomic<uint64_t> counts[BUCKETS];
+        atomic<uint64_t> sum_ns;
+        atomic<uint64_t> max_ns;
+    };
+
+    inline Shard shards[STAGES][SHARDS];
+    inline atomic<bool> on{false};
+    inline atomic<int> route_filter{-1}; // trace route to profile, -1 = all
+    inline double ns_per_tick = 1.0;     // set before on is first stored
+    inline thread_local bool active = false;
+    inline thread_local uint64_t request_start = 0;
+
+    inline uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // TSC rate against steady_clock, over 20 ms
+    inline void calibrate()
+    {
+        auto t0 = chrono::steady_clock::now();
+        uint64_t c0 = ticks();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        uint64_t c1 = ticks();
+        double ns = Metrics::since_ns(t0);
+        if (c1 > c0)
+            ns_per_tick = ns / (c1 - c0);
+    }
+
+    inline int bucket(uint64_t ns)
+    {
+        if (ns < (uint64_t)SUB)
+            return (int)ns;
+        int b = 63 - __builtin_clzll(ns);
+        int i = (b - 1) * SUB + (int)((ns >> (b - 2)) & (SUB - 1));
+        return i < BUCKETS ? i : BUCKETS - 1;
+    }
+
+    // largest value in bucket i
+    inline uint64_t bucket_high(int i)
+    {
+        if (i < SUB)
+            return i;
+        int b = i / SUB + 1;
+        return ((uint64_t)(SUB + i % SUB + 1) << (b - 2)) - 1;
+    }
+
+    inline void record_ns(Stage stage, uint64_t ns)
+    {
+        Shard &s = shards[stage][Metrics::shard() % SHARDS];
+        s.counts[bucket(ns)].fetch_add(1, memory_order_relaxed);
+        s.sum_ns.fetch_add(ns, memory_order_relaxed);
+        uint64_t m = s.max_ns.load(memory_order_relaxed);
+        while (ns > m && !s.max_ns.compare_exchange_weak(m, ns, memory_order_relaxed))
+        {
+        }
+    }
+
+    inline void record_ticks(Stage stage, uint64_t t) { record_ns(stage, (uint64_t)(t * ns_per_tick)); }
+
+    // enabling calibrates the TSC the first time
+    inline void enable(bool yes, int route = -1)
+    {
+        static once_flag calibrated;
+        if (yes)
+            call_once(calibrated, calibrate);
+        route_filter.store(route, memory_order_relaxed);
+        on.store(yes, memory_order_release);
+    }
+
+    inline void reset()
+    {
+        for (auto &stage : shards)
+        {
+            for (auto &s : stage)
+            {
+                for (auto &c : s.counts)
+                    c.store(0, memory_order_relaxed);
+                s.sum_ns.store(0, memory_order_relaxed);
+                s.max_ns.store(0, memory_order_relaxed);
+            }
+        }
+    }
+
+    // pre-routing: profile this request or not
+    inline bool begin_request(int route)
+    {
+        if (!on.load(memory_order_acquire))
+            return active = false;
+        int filter = route_filter.load(memory_order_relaxed);
+        active = filter < 0 || filter == route;
+        if (active)
+            request_start = ticks();
+        return active;
+    }
+
+    // post-routing
+    inline void end_request()
+    {
+        if (!active)
+            return;
+        record_ticks(REQUEST, ticks() - request_start);
+        active = false;
+    }
+
+    // {"stage": "db_query", "count": .., "per_request_us": .., "mean_us": .., "p50_us": .., ...}
+    inline string stage_json(int stage, uint64_t requests)
+    {
+        uint64_t counts[BUCKETS] = {};
+        uint64_t total = 0, sum_ns = 0, max_ns = 0;
+        for (auto &s : shards[stage])
+        {
+            for (int i = 0; i < BUCKETS; i++)
+                counts[i] += s.counts[i].load(memory_order_relaxed);
+            sum_ns += s.sum_ns.load(memory_order_relaxed);
+            max_ns = max(max_ns, s.max_ns.load(memory_order_relaxed));
+        }
+        for (auto c : counts)
+            total += c;
+
+        auto percentile = [&](double p)
+        {
+            uint64_t want = max<uint64_t>(1, (uint64_t)(p * total + 0.5)), seen = 0;
+            for (int i = 0; i < BUCKETS; i++)
+            {
+                seen += counts[i];
+                if (seen >= want)
+                    return min(bucket_high(i), max_ns);
+            }
+            return max_ns;
+        };
+
+        char buf[384];
+        snprintf(buf, sizeof(buf),
+                 "{\"stage\": \"%s\", \"count\": %llu, \"per_request_us\": %.2f, \"mean_us\": %.2f, "
+                 "\"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}",
+                 name(stage), (unsigned long long)total, requests ? sum_ns / 1e3 / requests : 0.0,
+                 total ? sum_ns / 1e3 / total : 0.0, total ? percentile(0.5) / 1e3 : 0.0,
+                 total ? percentile(0.9) / 1e3 : 0.0, total ? percentile(0.99) / 1e3 : 0.0, max_ns / 1e3);
+        return buf;
+    }
+
+    inline uint64_t count(int stage)
+    {
+        uint64_t n = 0;
+        for (auto &s : shards[stage])
+        {
+            for (auto &c : s.counts)
+                n += c.load(memory_order_relaxed);
+        }
+        return n;
+    }
+}
+
+// times the enclosing scope (or up to stop()) into a stage, when the
+// current request is profiled
+class ProfileTimer
+{
+private:
+    Profile::Stage stage;
+    uint64_t start;
+
+public:
+    explicit ProfileTimer(Profile::Stage s) : stage(s), start(Profile::active ? Profile::ticks() : 0) {}
+    ~ProfileTimer() { stop(); }
+
+    void stop()
+    {
+        if (start)
+        {
+            Profile::record_ticks(stage, Profile::ticks() - start);
+            start = 0;
+        }
+    }
+};
+
+#endif
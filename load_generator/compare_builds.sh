@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# Compare two server builds on the same workload (e.g. before/after an optimization)
+# Usage: ./compare_builds.sh <old_kv_server> <new_kv_server> [workload] [threads] [duration]
+#
+# Each binary is started in turn on port 8080 (no flags, so older builds work),
+# the load generator runs against it, and the key numbers are printed side by side.
+
+OLD_BIN=$1
+NEW_BIN=$2
+WORKLOAD=${3:-"compute_prime"}
+THREADS=${4:-10}
+DURATION=${5:-30}
+SERVER_HOST="127.0.0.1"
+SERVER_PORT=8080
+
+if [ -z "$OLD_BIN" ] || [ -z "$NEW_BIN" ]; then
+    echo "Usage: $0 <old_kv_server> <new_kv_server> [workload] [threads] [duration]"
+    exit 1
+fi
+
+if pgrep -x kv-server > /dev/null; then
+    echo "Error: kv-server is already running, please stop it first."
+    exit 1
+fi
+
+RESULTS_DIR="results_compare_${WORKLOAD}_$(date +%Y%m%d_%H%M%S)"
+mkdir -p "$RESULTS_DIR"
+
+echo "=========================================="
+echo "Comparing builds on $WORKLOAD"
+echo "=========================================="
+echo "Old:      $OLD_BIN"
+echo "New:      $NEW_BIN"
+echo "Threads:  $THREADS"
+echo "Duration: $DURATION seconds per build"
+echo "=========================================="
+echo ""
+
+run_build() {
+    local NAME=$1
+    local BIN=$2
+
+    echo "Running $NAME build..."
+    taskset -c 3-8 "$BIN" > "$RESULTS_DIR/server_${NAME}.log" 2>&1 &
+    local PID=$!
+
+    for i in $(seq 1 30); do
+        curl -s "http://$SERVER_HOST:$SERVER_PORT/status" > /dev/null 2>&1 && break
+        sleep 0.5
+    done
+
+    taskset -c 9-11 ./load-generator -h "$SERVER_HOST" -p "$SERVER_PORT" \
+        -t "$THREADS" -d "$DURATION" -w "$WORKLOAD" > "$RESULTS_DIR/test_${NAME}.log"
+
+    kill -INT $PID 2>/dev/null
+    wait $PID 2>/dev/null
+    sleep 2
+}
+
+run_build old "$OLD_BIN"
+run_build new "$NEW_BIN"
+
+# Pull numbers out of both reports
+metric() {
+    grep "$2" "$RESULTS_DIR/test_$1.log" | head -1 | awk "{print \$$3}"
+}
+
+echo ""
+printf "%-22s %12s %12s\n" "" "old" "new"
+printf "%-22s %12s %12s\n" "Throughput (req/s)" "$(metric old 'Average Throughput' 3)" "$(metric new 'Average Throughput' 3)"
+printf "%-22s %12s %12s\n" "Avg response (ms)" "$(metric old 'Average Response Time' 4)" "$(metric new 'Average Response Time' 4)"
+printf "%-22s %12s %12s\n" "P50 (ms)" "$(metric old 'P50' 3)" "$(metric new 'P50' 3)"
+printf "%-22s %12s %12s\n" "P99 (ms)" "$(metric old 'P99:' 2)" "$(metric new 'P99:' 2)"
+echo ""
+echo "Logs saved to: $RESULTS_DIR"
@@ -0,0 +1,122 @@
+// HDR-style latency histogram for the load generator
+// Fixed memory, O(1) record, 3 significant digits from 1 us up to 1 hour
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Values are whole microseconds. Buckets are log-linear: each power of two
+// range is split into 1024 sub-buckets, so any recorded value is off by at
+// most 1/1024 (~0.1%). One histogram per thread, merged at the end.
+class Histogram
+{
+private:
+    static const int SUB_BITS = 10;                 // 1024 sub-buckets per half range
+    static const int64_t SUB_COUNT = 2 << SUB_BITS; // 2048, covers 3 significant digits
+    static const int64_t SUB_HALF = SUB_COUNT / 2;
+    static const int64_t SUB_MASK = SUB_COUNT - 1;
+
+    int64_t max_trackable;
+    int bucket_count;
+    vector<uint64_t> counts;
+
+    uint64_t total = 0;
+    int64_t min_value = INT64_MAX;
+    int64_t max_value = 0;
+    double sum = 0;
+
+    int bucket_index(int64_t v) const
+    {
+        return 63 - __builtin_clzll(v | SUB_MASK) - SUB_BITS;
+    }
+
+    size_t counts_index(int64_t v) const
+    {
+        int b = bucket_index(v);
+        int64_t sub = v >> b;
+        return ((size_t)b << SUB_BITS) + sub;
+    }
+
+    // largest value that lands in the same slot as counts[i]
+    int64_t highest_equivalent(size_t i) const
+    {
+        int b = (int)(i >> SUB_BITS) - 1;
+        int64_t sub = (int64_t)(i & (SUB_HALF - 1)) + SUB_HALF;
+        if (b < 0)
+        {
+            b = 0;
+            sub -= SUB_HALF;
+        }
+        return ((sub + 1) << b) - 1;
+    }
+
+public:
+    Histogram(int64_t max_us = 3600LL * 1000000) : max_trackable(max_us)
+    {
+        bucket_count = 1;
+        while ((SUB_COUNT << (bucket_count - 1)) <= max_trackable)
+            bucket_count++;
+        counts.assign((size_t)(bucket_count + 1) << SUB_BITS, 0);
+    }
+
+    void record(int64_t us)
+    {
+        us = std::min(std::max(us, (int64_t)0), max_trackable);
+        counts[counts_index(us)]++;
+        total++;
+        sum += us;
+        min_value = std::min(min_value, us);
+        max_value = std::max(max_value, us);
+    }
+
+    // record a latency given in milliseconds
+    void record_ms(double ms) { record(llround(ms * 1000)); }
+
+    void merge(const Histogram &o)
+    {
+        for (size_t i = 0; i < counts.size() && i < o.counts.size(); i++)
+            counts[i] += o.counts[i];
+        total += o.total;
+        sum += o.sum;
+        min_value = std::min(min_value, o.min_value);
+        max_value = std::max(max_value, o.max_value);
+    }
+
+    void reset()
+    {
+        fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0;
+        min_value = INT64_MAX;
+        max_value = 0;
+    }
+
+    uint64_t count() const { return total; }
+    int64_t max() const { return max_value; }
+    int64_t min() const { return total ? min_value : 0; }
+    double mean() const { return total ? sum / total : 0; }
+
+    // value at percentile p (0-100), in microseconds
+    int64_t percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t want = std::max<uint64_t>(1, (uint64_t)ceil(p / 100.0 * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            seen += counts[i];
+            if (seen >= want)
+                return std::min(highest_equivalent(i), max_value);
+        }
+        return max_value;
+    }
+};
+
+#endif
@@ -0,0 +1,185 @@
+// Key popularity distributions for the load generator
+// uniform, zipfian, scrambled zipfian, latest and hotspot (as in YCSB)
+
+#ifndef KEY_DISTRIBUTION_H
+#define KEY_DISTRIBUTION_H
+
+#include <string>
+#include <random>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Picks key ids in [0, n). Built once per run and shared by all threads:
+// next() only reads the precomputed constants, and the rng is the caller's.
+//
+//   uniform    every key equally likely
+//   zipfian    key i has weight 1 / (i+1)^theta, so the low ids are hot
+//   scrambled  zipfian, with the ranks hashed over the key space so the hot
+//              keys are not neighbours
+//   latest     zipfian over the distance from the newest inserted key, so
+//              recently created keys are hot (creates take next_insert())
+//   hotspot    hot_ops of the requests go to the first hot_keys of the keys,
+//              the rest to the others, uniform within each set
+class KeyDistribution
+{
+public:
+    enum Type
+    {
+        UNIFORM,
+        ZIPFIAN,
+        SCRAMBLED,
+        LATEST,
+        HOTSPOT
+    };
+
+private:
+    Type type;
+    uint64_t n;
+    double theta;
+    double hot_keys, hot_ops;
+
+    // zipfian constants (Gray et al., "Quickly generating billion-record
+    // synthetic databases", as used by YCSB)
+    double zetan = 0, alpha = 0, eta = 0, half_pow_theta = 0;
+
+    atomic<uint64_t> inserted; // keys 0..inserted-1 exist (latest)
+
+    static uint64_t fnv64(uint64_t v)
+    {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (int i = 0; i < 8; i++)
+        {
+            h ^= v & 0xFF;
+            h *= 0x100000001B3ULL;
+            v >>= 8;
+        }
+        return h;
+    }
+
+    // sum of 1/i^theta for i = 1..count; exact for the first million terms,
+    // Euler-Maclaurin for the tail so a billion keys doesn't take seconds
+    static double zeta(uint64_t count, double theta)
+    {
+        const uint64_t EXACT = 1000000;
+        double sum = 0;
+        uint64_t m = min(count, EXACT);
+        for (uint64_t i = 1; i <= m; i++)
+            sum += pow((double)i, -theta);
+        if (count > m)
+        {
+            double a = (double)m, b = (double)count;
+            sum += (pow(b, 1 - theta) - pow(a, 1 - theta)) / (1 - theta);
+            sum += (pow(b, -theta) - pow(a, -theta)) / 2;
+        }
+        return sum;
+    }
+
+    // zipfian rank in [0, n), 0 the most popular
+    uint64_t zipf(mt19937 &rng) const
+    {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0)
+            return 0;
+        if (uz < 1.0 + half_pow_theta)
+            return min<uint64_t>(1, n - 1);
+        uint64_t r = (uint64_t)(n * pow(eta * u - eta + 1, alpha));
+        return min(r, n - 1);
+    }
+
+public:
+    KeyDistribution(Type t, uint64_t keys, double zipf_theta = 0.99,
+                    double hot_key_fraction = 0.2, double hot_op_fraction = 0.8)
+        : type(t), n(max<uint64_t>(keys, 1)), theta(zipf_theta),
+          hot_keys(hot_key_fraction), hot_ops(hot_op_fraction), inserted(n)
+    {
+        if (type == ZIPFIAN || type == SCRAMBLED || type == LATEST)
+        {
+            zetan = zeta(n, theta);
+            double zeta2 = 1.0 + pow(2.0, -theta);
+            alpha = 1.0 / (1.0 - theta);
+            eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+            half_pow_theta = pow(0.5, theta);
+        }
+    }
+
+    static bool parse(const string &name, Type &out)
+    {
+        if (name == "uniform")
+            out = UNIFORM;
+        else if (name == "zipfian")
+            out = ZIPFIAN;
+        else if (name == "scrambled")
+            out = SCRAMBLED;
+        else if (name == "latest")
+            out = LATEST;
+        else if (name == "hotspot")
+            out = HOTSPOT;
+        else
+            return false;
+        return true;
+    }
+
+    string describe() const
+    {
+        switch (type)
+        {
+        case ZIPFIAN:
+            return "zipfian (theta " + to_string(theta).substr(0, 4) + ")";
+        case SCRAMBLED:
+            return "scrambled zipfian (theta " + to_string(theta).substr(0, 4) + ")";
+        case LATEST:
+            return "latest (theta " + to_string(theta).substr(0, 4) + ")";
+        case HOTSPOT:
+            return "hotspot (" + to_string((int)(hot_ops * 100)) + "% of requests to " +
+                   to_string((int)(hot_keys * 100)) + "% of keys)";
+        default:
+            return "uniform";
+        }
+    }
+
+    uint64_t size() const { return n; }
+
+    // key id for a read, update or delete
+    uint64_t next(mt19937 &rng) const
+    {
+        switch (type)
+        {
+        case ZIPFIAN:
+            return zipf(rng);
+        case SCRAMBLED:
+            return fnv64(zipf(rng)) % n;
+        case LATEST:
+        {
+            uint64_t last = inserted.load(memory_order_relaxed) - 1;
+            uint64_t back = zipf(rng);
+            return back > last ? 0 : last - back;
+        }
+        case HOTSPOT:
+        {
+            uint64_t hot = max<uint64_t>(1, (uint64_t)(n * hot_keys));
+            bool to_hot = hot >= n || uniform_real_distribution<double>(0.0, 1.0)(rng) < hot_ops;
+            if (to_hot)
+                return uniform_int_distribution<uint64_t>(0, hot - 1)(rng);
+            return uniform_int_distribution<uint64_t>(hot, n - 1)(rng);
+        }
+        default:
+            return uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+        }
+    }
+
+    // key id for a create: a fresh id past the key space for latest, so it
+    // becomes the hottest key, otherwise drawn like next()
+    uint64_t next_insert(mt19937 &rng)
+    {
+        if (type == LATEST)
+            return inserted.fetch_add(1, memory_order_relaxed);
+        return next(rng);
+    }
+};
+
+#endif
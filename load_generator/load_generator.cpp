@@ -1,5 +1,7 @@
 // Load Generator for KV Store Server
-// Closed-loop multi-threaded load generator with configurable workloads
+// Multi-threaded load generator with configurable workloads: closed loop by
+// default, open loop at a fixed rate with --rate, or stepped up to saturation
+// with --sweep
 
 #include <iostream>
 #include <thread>
@@ -11,11 +13,24 @@
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
+#include <climits>
+#include <deque>
+#include <cerrno>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sstream>
+#include <memory>
+#include "hdr_histogram.h"
+#include "key_distribution.h"
+#include "trace_replay.h"
+#include "workload_spec.h"
 
 using namespace std;
 using namespace chrono;
@@ -27,47 +42,310 @@ struct Config
     int server_port = 8080;
     int num_threads = 1;
     int duration_seconds = 60;
-    string workload_type = "get_all"; // get_all, put_all, get_popular, mixed
+    string workload_type = "get_all"; // built-in workload name or spec file
+    shared_ptr<WorkloadSpec> spec;    // compiled from workload_type by parse_args
+    string phase;                     // load or run, "" = the spec's own
+    int value_size = 0;               // >0: every value this many bytes, overrides the spec
+    bool preload = false;             // fill the key space before the run, untimed
+    int preload_batch = 1000;         // rows per /kv/bulk_load request, 0 = one create per key
     int timeout_ms = 5000;            // socket timeout
+    bool binary = false;              // use the binary kv protocol instead of HTTP
+    int binary_port = 9090;
+    int pipeline = 1;                 // requests in flight per connection (>1 = pipelined)
+    bool keep_alive = false;          // reuse one HTTP connection per thread
+    int connections = 0;              // >0: epoll engine, this many connections over the threads
+
+    // key popularity
+    string key_dist = "uniform";      // uniform, zipfian, scrambled, latest, hotspot
+    long key_count = 1000000;         // key space for key_N
+    double zipf_theta = 0.99;         // skew for zipfian, scrambled and latest
+    double hot_keys = 0.2;            // hotspot: fraction of keys that are hot
+    double hot_ops = 0.8;             // hotspot: fraction of requests that go to them
+    int popular_keys = 0;             // popular_key_N set size, 0 = the workload's (or 10)
+    shared_ptr<KeyDistribution> keys; // built from the above by parse_args, shared by all threads
+
+    // trace replay instead of a synthetic workload
+    string replay_file;               // server trace (trace_file option), "" = off
+    double replay_speed = 1.0;        // 2 = twice as fast as recorded
+    shared_ptr<TraceReplay> replay;   // loaded by parse_args
+    bool duration_set = false;        // -d given, otherwise replay runs for the trace length
+
+    // open loop: requests are sent on a fixed schedule instead of back to back
+    double rate = 0;                  // target req/s over all threads, 0 = closed loop
+    string arrival = "poisson";       // poisson or constant inter-arrival times
+    bool sweep = false;               // step the rate up until the server saturates
+    double sweep_factor = 1.25;       // rate multiplier per sweep step
+    double sweep_max = 1000000;       // highest rate to try
+    double slo_ms = 0;                // p99 bound for the sweep, 0 = 10x the first step's p99
+
+    // result files, "" = off
+    string csv_file;                  // 1 s time series
+    string json_file;                 // everything: totals, routes, statuses, sources, series
 };
 
-// Metrics collection
-struct Metrics
+// Where the server says a response came from (its "source" field)
+enum Source
+{
+    SRC_NONE, // no source field (creates, deletes, scans, errors)
+    SRC_CACHE,
+    SRC_DATABASE,
+    SRC_COMPUTED,
+    SRC_INLINE,
+    SOURCES
+};
+
+const char *source_name(int s)
+{
+    static const char *names[] = {"none", "cache", "database", "computed", "inline"};
+    return names[s];
+}
+
+// first "source" field in a response, e.g. {"success": true, ..., "source": "cache"}
+int response_source(const char *data, size_t len)
+{
+    static const char tag[] = "\"source\": \"";
+    const char *p = (const char *)memmem(data, len, tag, sizeof(tag) - 1);
+    if (!p)
+        return SRC_NONE;
+    p += sizeof(tag) - 1;
+    size_t left = data + len - p;
+    for (int s = SRC_CACHE; s < SOURCES; s++)
+    {
+        size_t n = strlen(source_name(s));
+        if (left > n && memcmp(p, source_name(s), n) == 0 && p[n] == '"')
+            return s;
+    }
+    return SRC_NONE;
+}
+
+// HTTP status codes are counted in [0, MAX_STATUS), 0 = no response
+const int MAX_STATUS = 600;
+
+// Metrics for one worker thread, written only by that thread so recording
+// takes no lock; counters are atomic so the progress line can read them
+struct alignas(64) ThreadMetrics
 {
     atomic<uint64_t> total_requests{0};
     atomic<uint64_t> successful_requests{0};
     atomic<uint64_t> failed_requests{0};
-    atomic<uint64_t> total_response_time_ms{0};
+    Histogram latency; // successful requests, microseconds
+
+    // time series: successful latency since the main thread last drained them
+    atomic<uint64_t> latency_count{0};
+    atomic<uint64_t> latency_sum_us{0};
+    atomic<int64_t> latency_max_us{0};
+
+    // per route (Trace::Route of the request path), status and source;
+    // read only after the workers have stopped
+    unique_ptr<Histogram> route_latency[Trace::ROUTES]; // allocated on first use
+    uint64_t route_ok[Trace::ROUTES] = {};
+    uint64_t route_failed[Trace::ROUTES] = {};
+    uint64_t status_counts[MAX_STATUS] = {};
+    uint64_t source_counts[SOURCES] = {};
+};
+
+// Metrics collection: per-thread, merged when the run ends
+struct Metrics
+{
+    vector<ThreadMetrics> threads;
+
+    Metrics(int n) : threads(n) {}
+
+    uint64_t total() const
+    {
+        uint64_t n = 0;
+        for (auto &t : threads)
+            n += t.total_requests.load(memory_order_relaxed);
+        return n;
+    }
+
+    uint64_t successful() const
+    {
+        uint64_t n = 0;
+        for (auto &t : threads)
+            n += t.successful_requests.load(memory_order_relaxed);
+        return n;
+    }
+
+    uint64_t failed() const
+    {
+        uint64_t n = 0;
+        for (auto &t : threads)
+            n += t.failed_requests.load(memory_order_relaxed);
+        return n;
+    }
+
+    // call after the workers have stopped
+    Histogram merged() const
+    {
+        Histogram all;
+        for (auto &t : threads)
+            all.merge(t.latency);
+        return all;
+    }
 
-    mutex mtx;
-    vector<double> response_times; // for detailed stats
+    // successful latency of one route, empty if it had none
+    Histogram merged_route(int route) const
+    {
+        Histogram all;
+        for (auto &t : threads)
+        {
+            if (t.route_latency[route])
+                all.merge(*t.route_latency[route]);
+        }
+        return all;
+    }
+
+    // one time series point: successful latency since the last call
+    void take_interval(uint64_t &count, uint64_t &sum_us, int64_t &max_us)
+    {
+        count = 0;
+        sum_us = 0;
+        max_us = 0;
+        for (auto &t : threads)
+        {
+            count += t.latency_count.exchange(0, memory_order_relaxed);
+            sum_us += t.latency_sum_us.exchange(0, memory_order_relaxed);
+            max_us = max(max_us, t.latency_max_us.exchange(0, memory_order_relaxed));
+        }
+    }
 };
 
+// Parse one HTTP/1.1 response at the front of buf. The body is framed by
+// Content-Length, chunked encoding, or (neither) the server closing, so
+// eof says whether the connection has been closed after buf.
+// Returns 1 when the response is complete (consumed = its length in buf),
+// 0 if more bytes are needed, -1 if it is malformed. If response is set it
+// gets the header block plus the decoded body.
+int parse_http_response(const string &buf, bool eof, size_t &consumed, int &status,
+                        bool &server_closes, string *response)
+{
+    size_t hdr_end = buf.find("\r\n\r\n");
+    if (hdr_end == string::npos)
+        return eof ? -1 : 0;
+
+    if (buf.compare(0, 5, "HTTP/") != 0 || buf.size() < 12)
+        return -1;
+    status = atoi(buf.c_str() + 9);
+
+    string headers = buf.substr(0, hdr_end);
+    for (auto &c : headers)
+        c = tolower(c);
+    bool chunked = headers.find("transfer-encoding: chunked") != string::npos;
+    size_t cl = headers.find("content-length:");
+    server_closes = headers.find("connection: close") != string::npos ||
+                    headers.compare(0, 8, "http/1.0") == 0;
+
+    if (response)
+        response->assign(buf, 0, hdr_end + 4);
+    size_t pos = hdr_end + 4;
+
+    if (chunked)
+    {
+        for (;;)
+        {
+            size_t line_end = buf.find("\r\n", pos);
+            if (line_end == string::npos)
+                return eof ? -1 : 0;
+            size_t size = strtoul(buf.c_str() + pos, nullptr, 16);
+            pos = line_end + 2;
+            if (size == 0)
+                break;
+            if (buf.size() < pos + size + 2)
+                return eof ? -1 : 0;
+            if (response)
+                response->append(buf, pos, size);
+            pos += size + 2;
+        }
+        // optional trailers, then an empty line
+        for (;;)
+        {
+            size_t end = buf.find("\r\n", pos);
+            if (end == string::npos)
+                return eof ? -1 : 0;
+            bool last = end == pos;
+            pos = end + 2;
+            if (last)
+                break;
+        }
+    }
+    else if (cl != string::npos)
+    {
+        size_t end = pos + strtoul(headers.c_str() + cl + 15, nullptr, 10);
+        if (buf.size() < end)
+            return eof ? -1 : 0;
+        if (response)
+            response->append(buf, pos, end - pos);
+        pos = end;
+    }
+    else
+    {
+        // no framing: the body runs until the server closes
+        if (!eof)
+            return 0;
+        if (response)
+            response->append(buf, pos, string::npos);
+        pos = buf.size();
+        server_closes = true;
+    }
+
+    consumed = pos;
+    return 1;
+}
+
+// Read one HTTP/1.1 response from a blocking sock. buf holds bytes already
+// received and keeps any that belong to the next response.
+// Returns the status code, -1 on error, -2 if the connection was closed
+// before any byte arrived (a stale keep-alive connection).
+int read_http_response(int sock, string &buf, string &response, bool &server_closes)
+{
+    char chunk[16384];
+    bool eof = false;
+    for (;;)
+    {
+        size_t consumed;
+        int status;
+        int r = parse_http_response(buf, eof, consumed, status, server_closes, &response);
+        if (r > 0)
+        {
+            buf.erase(0, consumed);
+            return status;
+        }
+        if (r < 0)
+            return -1;
+
+        ssize_t n = recv(sock, chunk, sizeof(chunk), 0);
+        if (n < 0)
+            return -1;
+        if (n == 0 && buf.empty())
+            return -2;
+        if (n == 0)
+            eof = true;
+        else
+            buf.append(chunk, n);
+    }
+}
+
 // Simple HTTP client
+// Default: a new connection per request (Connection: close), so every
+// request pays a TCP handshake. With keep_alive one connection is reused
+// until the server closes it, then reopened.
 class HTTPClient
 {
 private:
     string host;
     int port;
     int timeout_ms;
+    bool keep_alive;
+    int sock = -1;
+    string buf;          // received bytes not yet parsed
+    int status_code = 0; // of the last response, 0 = none
 
-public:
-    HTTPClient(const string &h, int p, int timeout)
-        : host(h), port(p), timeout_ms(timeout) {}
-
-    bool send_request(const string &method, const string &path,
-                      const string &query_params, string &response,
-                      double &response_time_ms)
+    bool connect_server()
     {
-        auto start = high_resolution_clock::now();
-
-        // Create socket
-        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        sock = socket(AF_INET, SOCK_STREAM, 0);
         if (sock < 0)
-        {
-            response_time_ms = 0;
             return false;
-        }
 
         // Set timeout
         struct timeval tv;
@@ -75,6 +353,12 @@ public:
         tv.tv_usec = (timeout_ms % 1000) * 1000;
         setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
         setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        if (keep_alive)
+        {
+            // small requests back to back, don't let Nagle hold them
+            int one = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
 
         // Connect
         struct sockaddr_in server_addr;
@@ -82,19 +366,38 @@ public:
         server_addr.sin_family = AF_INET;
         server_addr.sin_port = htons(port);
 
-        if (inet_pton(AF_INET, host.c_str(), &server_addr.sin_addr) <= 0)
+        if (inet_pton(AF_INET, host.c_str(), &server_addr.sin_addr) <= 0 ||
+            connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
         {
-            close(sock);
-            response_time_ms = 0;
+            disconnect();
             return false;
         }
+        return true;
+    }
 
-        if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
-        {
+    void disconnect()
+    {
+        if (sock >= 0)
             close(sock);
-            response_time_ms = 0;
-            return false;
-        }
+        sock = -1;
+        buf.clear();
+    }
+
+public:
+    HTTPClient(const string &h, int p, int timeout, bool reuse = false)
+        : host(h), port(p), timeout_ms(timeout), keep_alive(reuse) {}
+
+    ~HTTPClient() { disconnect(); }
+
+    int last_status() const { return status_code; }
+
+    bool send_request(const string &method, const string &path,
+                      const string &query_params, string &response,
+                      double &response_time_ms, const string &body = string())
+    {
+        auto start = high_resolution_clock::now();
+        response_time_ms = 0;
+        status_code = 0;
 
         // Build HTTP request
         stringstream request;
@@ -105,74 +408,379 @@ public:
         }
         request << " HTTP/1.1\r\n";
         request << "Host: " << host << "\r\n";
-        request << "Connection: close\r\n";
-        request << "Content-Length: 0\r\n";
+        request << (keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+        request << "Content-Length: " << body.size() << "\r\n";
         request << "\r\n";
 
-        string req_str = request.str();
+        string req_str = request.str() + body;
+
+        // a reused connection may have been closed by the server meanwhile
+        // (idle timeout, max requests per connection): retry once on a new one
+        int status = -1;
+        for (int attempt = 0; attempt < 2; attempt++)
+        {
+            bool reused = sock >= 0;
+            if (!reused && !connect_server())
+                return false;
+
+            // Send request
+            if (send(sock, req_str.data(), req_str.size(), MSG_NOSIGNAL) != (ssize_t)req_str.size())
+            {
+                disconnect();
+                if (reused)
+                    continue;
+                return false;
+            }
+
+            // Receive response
+            bool server_closes = false;
+            status = read_http_response(sock, buf, response, server_closes);
+            if (status < 0)
+            {
+                disconnect();
+                if (reused && status == -2)
+                    continue;
+                return false;
+            }
+            if (!keep_alive || server_closes)
+                disconnect();
+            status_code = status;
+            break;
+        }
+
+        auto end = high_resolution_clock::now();
+        response_time_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+        // Check if response indicates success (2xx or 404 for gets is acceptable)
+        return (status >= 200 && status < 300) || (method == "GET" && status == 404);
+    }
+};
+
+// Client for the server's binary kv protocol (see server/binary_server.h)
+// Keeps one connection open, reconnecting after errors
+class BinaryClient
+{
+private:
+    string host;
+    int port;
+    int timeout_ms;
+    int sock = -1;
+    int status_code = 0; // last response as an HTTP status, 0 = none
+
+    enum Op : uint8_t
+    {
+        OP_GET = 1,
+        OP_SET = 2,
+        OP_DEL = 3,
+    };
+
+    static void put_u16(string &out, uint16_t v)
+    {
+        v = htons(v);
+        out.append((const char *)&v, 2);
+    }
+
+    static void put_u32(string &out, uint32_t v)
+    {
+        v = htonl(v);
+        out.append((const char *)&v, 4);
+    }
 
-        // Send request
-        ssize_t sent = send(sock, req_str.c_str(), req_str.length(), 0);
-        if (sent < 0)
+    bool connect_server()
+    {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0)
+            return false;
+
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &server_addr.sin_addr) <= 0 ||
+            connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
         {
+            disconnect();
+            return false;
+        }
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (sock >= 0)
             close(sock);
-            response_time_ms = 0;
+        sock = -1;
+    }
+
+    bool read_exact(char *buf, size_t n)
+    {
+        while (n > 0)
+        {
+            ssize_t r = recv(sock, buf, n, 0);
+            if (r <= 0)
+                return false;
+            buf += r;
+            n -= r;
+        }
+        return true;
+    }
+
+    // extract a query parameter from "key=...&value=..."
+    static string param(const string &params, const string &name)
+    {
+        size_t pos = 0;
+        while (pos < params.size())
+        {
+            size_t end = params.find('&', pos);
+            if (end == string::npos)
+                end = params.size();
+            if (params.compare(pos, name.size() + 1, name + "=") == 0)
+                return params.substr(pos + name.size() + 1, end - pos - name.size() - 1);
+            pos = end + 1;
+        }
+        return "";
+    }
+
+public:
+    BinaryClient(const string &h, int p, int timeout)
+        : host(h), port(p), timeout_ms(timeout) {}
+
+    ~BinaryClient() { disconnect(); }
+
+    int last_status() const { return status_code; }
+
+    // same signature as HTTPClient so workloads stay unchanged;
+    // only the /kv routes map onto the binary protocol
+    bool send_request(const string &method, const string &path,
+                      const string &query_params, string &response,
+                      double &response_time_ms)
+    {
+        auto start = high_resolution_clock::now();
+        response_time_ms = 0;
+        status_code = 0;
+
+        string key = param(query_params, "key");
+        string body;
+        uint8_t op;
+        if (path == "/kv/read")
+            op = OP_GET;
+        else if (path == "/kv/create")
+            op = OP_SET;
+        else if (path == "/kv/delete")
+            op = OP_DEL;
+        else
             return false;
+
+        body += (char)op;
+        put_u16(body, key.size());
+        body += key;
+        if (op == OP_SET)
+        {
+            string value = param(query_params, "value");
+            put_u32(body, value.size());
+            body += value;
         }
 
-        // Receive response
-        char buffer[4096];
-        string full_response;
-        ssize_t received;
+        string frame;
+        put_u32(frame, body.size());
+        frame += body;
 
-        while ((received = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0)
+        if (sock < 0 && !connect_server())
+            return false;
+
+        if (send(sock, frame.data(), frame.size(), MSG_NOSIGNAL) != (ssize_t)frame.size())
         {
-            buffer[received] = '\0';
-            full_response += buffer;
+            disconnect();
+            return false;
         }
 
-        close(sock);
+        uint32_t len;
+        if (!read_exact((char *)&len, 4))
+        {
+            disconnect();
+            return false;
+        }
+        len = ntohl(len);
+        if (len == 0 || len > 16 * 1024 * 1024)
+        {
+            disconnect();
+            return false;
+        }
+        response.resize(len);
+        if (!read_exact(&response[0], len))
+        {
+            disconnect();
+            return false;
+        }
 
         auto end = high_resolution_clock::now();
         response_time_ms = duration_cast<microseconds>(end - start).count() / 1000.0;
 
-        if (full_response.empty())
+        // status byte: 0 = ok, 1 = not found (acceptable for reads)
+        uint8_t status = response[0];
+        status_code = status == 0 ? 200 : status == 1 ? 404 : 500;
+        return status == 0 || (op == OP_GET && status == 1);
+    }
+};
+
+// HTTP/1.1 client that pipelines a batch of requests on a keep-alive connection
+// Point it at the server's pipelined listener (port 8081)
+class PipelineClient
+{
+private:
+    string host;
+    int port;
+    int timeout_ms;
+    int sock = -1;
+    string buf; // bytes received but not yet parsed
+
+    bool connect_server()
+    {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0)
+            return false;
+
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &server_addr.sin_addr) <= 0 ||
+            connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
         {
+            disconnect();
             return false;
         }
+        return true;
+    }
 
-        response = full_response;
+    void disconnect()
+    {
+        if (sock >= 0)
+            close(sock);
+        sock = -1;
+        buf.clear();
+    }
 
-        // Check if response indicates success (2xx or 404 for gets is acceptable)
-        if (full_response.find("HTTP/1.1 2") != string::npos ||
-            (method == "GET" && full_response.find("HTTP/1.1 404") != string::npos))
+    // read one response, returns its status code or -1 on error
+    int read_response(int &source)
+    {
+        string response;
+        bool server_closes;
+        int status = read_http_response(sock, buf, response, server_closes);
+        source = response_source(response.data(), response.size());
+        return status < 0 ? -1 : status;
+    }
+
+public:
+    struct Request
+    {
+        string method, path, params;
+        int status = 0; // filled in by send_batch, 0 = no response
+        int source = SRC_NONE;
+    };
+
+    PipelineClient(const string &h, int p, int timeout)
+        : host(h), port(p), timeout_ms(timeout) {}
+
+    ~PipelineClient() { disconnect(); }
+
+    // send all requests in one write, then read the responses in order
+    // times[i] is measured from the batch send to response i arriving
+    void send_batch(vector<Request> &batch, vector<bool> &ok, vector<double> &times)
+    {
+        ok.assign(batch.size(), false);
+        times.assign(batch.size(), 0.0);
+
+        string out;
+        for (auto &r : batch)
         {
-            return true;
+            out += r.method + " " + r.path;
+            if (!r.params.empty())
+                out += "?" + r.params;
+            out += " HTTP/1.1\r\nHost: " + host + "\r\nContent-Length: 0\r\n\r\n";
         }
 
-        return false;
+        if (sock < 0 && !connect_server())
+            return;
+
+        auto start = high_resolution_clock::now();
+        if (send(sock, out.data(), out.size(), MSG_NOSIGNAL) != (ssize_t)out.size())
+        {
+            disconnect();
+            return;
+        }
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            int status = read_response(batch[i].source);
+            if (status < 0)
+            {
+                disconnect(); // the rest of the batch counts as failed
+                return;
+            }
+            auto end = high_resolution_clock::now();
+            times[i] = duration_cast<microseconds>(end - start).count() / 1000.0;
+            // 2xx, or 404 for gets, is acceptable (same rule as HTTPClient)
+            ok[i] = (status >= 200 && status < 300) || (batch[i].method == "GET" && status == 404);
+            batch[i].status = status;
+        }
     }
 };
 
-// Workload generators
+// Workload generator: one per thread, draws requests from the compiled spec
 class WorkloadGenerator
 {
 private:
     int thread_id;
+    const WorkloadSpec *spec;
+    KeyDistribution *keys;
+    int popular_keys;
+    unique_ptr<KeyDistribution> value_zipf, scan_zipf; // length distributions, if zipfian
+    bool load_phase;
+    uint64_t load_next, load_step, load_end; // load phase: this thread's key ids
+    string rmw_key;                          // read-modify-write: update still to send
 
 public:
     mt19937 rng;
 
-    WorkloadGenerator(int tid) : thread_id(tid)
+    WorkloadGenerator(int tid, const Config &config)
+        : thread_id(tid), spec(config.spec.get()), keys(config.keys.get()), popular_keys(config.popular_keys),
+          load_phase(config.phase == "load"), load_next(tid), load_step(config.num_threads),
+          load_end(config.keys->size())
     {
         rng.seed(thread_id + time(nullptr));
+        if (spec->value_distribution == "zipfian")
+            value_zipf.reset(new KeyDistribution(KeyDistribution::ZIPFIAN, spec->value_max - spec->value_min + 1));
+        if (spec->scan_distribution == "zipfian")
+            scan_zipf.reset(new KeyDistribution(KeyDistribution::ZIPFIAN, spec->scan_max));
+    }
+
+    // Generate key for a read, update or delete, following the key distribution
+    string random_key()
+    {
+        return "key_" + to_string(keys->next(rng));
     }
 
-    // Generate random key
-    string random_key(int min_id = 0, int max_id = 1000000)
+    // Generate key for a create (newest key under --key-dist latest)
+    string insert_key()
     {
-        uniform_int_distribution<int> dist(min_id, max_id);
-        return "key_" + to_string(dist(rng));
+        return "key_" + to_string(keys->next_insert(rng));
     }
 
     // Generate random value
@@ -188,9 +796,22 @@ public:
         return value;
     }
 
-    // Generate popular key (from small set)
+    // Value for a create: fieldcount fields, each from the field length distribution
+    string spec_value()
+    {
+        int length = spec->value_max;
+        if (value_zipf)
+            length = spec->value_min + (int)value_zipf->next(rng);
+        else if (spec->value_distribution == "uniform")
+            length = uniform_int_distribution<int>(spec->value_min, spec->value_max)(rng);
+        return random_value(length * spec->field_count);
+    }
+
+    // Generate popular key (from small set, --popular-keys overrides its size)
     string popular_key(int max_popular = 10)
     {
+        if (popular_keys > 0)
+            max_popular = popular_keys;
         uniform_int_distribution<int> dist(0, max_popular - 1);
         return "popular_key_" + to_string(dist(rng));
     }
@@ -201,157 +822,733 @@ public:
         uniform_real_distribution<double> dist(0.0, 1.0);
         return dist(rng);
     }
+
+    // Next request of the workload, false once a load phase has inserted
+    // this thread's share of the records
+    bool next(string &method, string &path, string &params)
+    {
+        if (load_phase)
+        {
+            if (load_next >= load_end)
+                return false;
+            method = "POST";
+            path = "/kv/create";
+            params = "key=key_" + to_string(load_next) + "&value=" + spec_value();
+            load_next += load_step;
+            return true;
+        }
+
+        if (!rmw_key.empty())
+        {
+            // the write half of a read-modify-write
+            method = "POST";
+            path = "/kv/create";
+            params = "key=" + rmw_key + "&value=" + spec_value();
+            rmw_key.clear();
+            return true;
+        }
+
+        // op table lookup, most likely op first
+        double u = random_double();
+        const WorkloadSpec::Op *op = &spec->ops.back();
+        for (auto &o : spec->ops)
+        {
+            if (u < o.upto)
+            {
+                op = &o;
+                break;
+            }
+        }
+
+        method = "GET";
+        switch (op->type)
+        {
+        case WorkloadSpec::READ:
+            path = "/kv/read";
+            params = "key=" + random_key();
+            break;
+        case WorkloadSpec::READ_POPULAR:
+            path = "/kv/read";
+            params = "key=" + popular_key();
+            break;
+        case WorkloadSpec::UPDATE:
+            method = "POST";
+            path = "/kv/create";
+            params = "key=" + random_key() + "&value=" + spec_value();
+            break;
+        case WorkloadSpec::INSERT:
+            method = "POST";
+            path = "/kv/create";
+            params = "key=" + insert_key() + "&value=" + spec_value();
+            break;
+        case WorkloadSpec::DELETE:
+            method = "DELETE";
+            path = "/kv/delete";
+            params = "key=" + random_key();
+            break;
+        case WorkloadSpec::SCAN:
+        {
+            int length = scan_zipf ? 1 + (int)scan_zipf->next(rng)
+                                   : uniform_int_distribution<int>(1, spec->scan_max)(rng);
+            path = "/kv/scan";
+            params = "start=" + random_key() + "&limit=" + to_string(length);
+            break;
+        }
+        case WorkloadSpec::READ_MODIFY_WRITE:
+            rmw_key = random_key();
+            path = "/kv/read";
+            params = "key=" + rmw_key;
+            break;
+        case WorkloadSpec::PRIME:
+            path = "/compute/prime";
+            params = "count=" + to_string(uniform_int_distribution<int>(spec->prime_min, spec->prime_max)(rng));
+            break;
+        case WorkloadSpec::HASH:
+        default:
+            path = "/compute/hash";
+            params = "text=" + random_value(spec->hash_length);
+            break;
+        }
+        return true;
+    }
+};
+
+// Record one completed request
+// route is a Trace::Route, status the HTTP status (0 = no response),
+// source from response_source()
+void record(ThreadMetrics &metrics, bool success, double response_time_ms,
+            int route, int status, int source)
+{
+    if (status < 0 || status >= MAX_STATUS)
+        status = 0;
+    metrics.status_counts[status]++;
+    metrics.source_counts[source]++;
+    if (success)
+    {
+        int64_t us = llround(response_time_ms * 1000);
+        metrics.successful_requests.fetch_add(1, memory_order_relaxed);
+        metrics.latency.record(us);
+        if (!metrics.route_latency[route])
+            metrics.route_latency[route].reset(new Histogram());
+        metrics.route_latency[route]->record(us);
+        metrics.route_ok[route]++;
+
+        metrics.latency_count.fetch_add(1, memory_order_relaxed);
+        metrics.latency_sum_us.fetch_add(us, memory_order_relaxed);
+        int64_t prev = metrics.latency_max_us.load(memory_order_relaxed);
+        while (us > prev && !metrics.latency_max_us.compare_exchange_weak(prev, us, memory_order_relaxed))
+        {
+        }
+    }
+    else
+    {
+        metrics.failed_requests.fetch_add(1, memory_order_relaxed);
+        metrics.route_failed[route]++;
+    }
+}
+
+// Open-loop schedule for one thread: each thread is its own arrival process
+// at rate / threads, so together they send at the target rate
+class ArrivalSchedule
+{
+private:
+    high_resolution_clock::time_point next;
+    double mean_gap_us;
+    bool poisson;
+    exponential_distribution<double> gap;
+
+public:
+    // unused in closed loop (rate 0)
+    ArrivalSchedule(const Config &config, int thread_id, high_resolution_clock::time_point start)
+        : mean_gap_us(1e6 * config.num_threads / (config.rate > 0 ? config.rate : 1)),
+          poisson(config.arrival == "poisson"),
+          gap(1.0 / mean_gap_us)
+    {
+        // constant arrivals: spread the threads' first sends over one gap
+        next = start + microseconds((long)(poisson ? 0 : mean_gap_us * thread_id / config.num_threads));
+    }
+
+    // intended send time of the next request, then advance the schedule
+    high_resolution_clock::time_point take(mt19937 &rng)
+    {
+        auto t = next;
+        double us = poisson ? gap(rng) : mean_gap_us;
+        next += nanoseconds((long)(us * 1000));
+        return t;
+    }
 };
 
 // Worker thread function
-void worker_thread(int thread_id, const Config &config, Metrics &metrics,
-                   atomic<bool> &should_stop)
+void worker_thread(int thread_id, const Config &config, ThreadMetrics &metrics,
+                   atomic<bool> &should_stop, high_resolution_clock::time_point start)
 {
 
-    HTTPClient client(config.server_host, config.server_port, config.timeout_ms);
-    WorkloadGenerator wg(thread_id);
+    HTTPClient client(config.server_host, config.server_port, config.timeout_ms, config.keep_alive);
+    BinaryClient binary_client(config.server_host, config.binary_port, config.timeout_ms);
+    PipelineClient pipeline_client(config.server_host, config.server_port, config.timeout_ms);
+    WorkloadGenerator wg(thread_id, config);
+    ArrivalSchedule schedule(config, thread_id, start);
+    bool open_loop = config.rate > 0 || config.replay;
+    size_t next_record = thread_id; // replay: this thread sends records thread_id, +threads, ...
 
     cout << "[Thread " << thread_id << "] Started\n";
 
     while (!should_stop.load())
     {
-        metrics.total_requests++;
-
-        string method, path, params, response;
-        double response_time_ms;
-        bool success = false;
+        // open loop: wait for the intended send time. If the server has fallen
+        // behind it is already past, and the time waited counts as latency
+        // (no coordinated omission)
+        high_resolution_clock::time_point intended;
+        if (config.replay)
+        {
+            if (next_record >= config.replay->size())
+                break; // trace done
+            intended = start + microseconds(config.replay->offset_us(next_record));
+        }
+        else if (config.rate > 0)
+        {
+            intended = schedule.take(wg.rng);
+        }
+        if (open_loop)
+        {
+            while (!should_stop.load() && high_resolution_clock::now() < intended)
+            {
+                this_thread::sleep_until(min(intended, high_resolution_clock::now() + milliseconds(50)));
+            }
+            if (should_stop.load())
+                break;
+        }
 
-        // Generate request based on workload type
-        if (config.workload_type == "put_all")
+        if (config.pipeline > 1)
         {
-            // Only create/delete operations
-            if (wg.random_double() < 0.9)
+            // Send a batch of requests back to back on one connection
+            vector<PipelineClient::Request> batch;
+            PipelineClient::Request r;
+            while ((int)batch.size() < config.pipeline && wg.next(r.method, r.path, r.params))
             {
-                // 90% creates
-                method = "POST";
-                path = "/kv/create";
-                params = "key=" + wg.random_key() + "&value=" + wg.random_value();
+                batch.push_back(r);
             }
-            else
+            if (batch.empty())
+                break; // load phase done
+            metrics.total_requests.fetch_add(batch.size(), memory_order_relaxed);
+
+            vector<bool> ok;
+            vector<double> times;
+            pipeline_client.send_batch(batch, ok, times);
+            for (size_t i = 0; i < batch.size(); i++)
             {
-                // 10% deletes
-                method = "DELETE";
-                path = "/kv/delete";
-                params = "key=" + wg.random_key();
+                record(metrics, ok[i], times[i], Trace::route(batch[i].method, batch[i].path),
+                       batch[i].status, batch[i].source);
             }
+            continue;
         }
-        else if (config.workload_type == "get_all")
+
+        string method, path, params, response;
+        double response_time_ms;
+        bool success = false;
+
+        if (config.replay)
         {
-            // Only read operations with unique keys (cache misses)
-            method = "GET";
-            path = "/kv/read";
-            params = "key=" + wg.random_key();
+            config.replay->request(next_record, method, path, params);
+            next_record += config.num_threads;
         }
-        else if (config.workload_type == "get_popular")
+        else if (!wg.next(method, path, params))
         {
-            // Only read operations with popular keys (cache hits)
-            method = "GET";
-            path = "/kv/read";
-            params = "key=" + wg.popular_key(10);
+            break; // load phase done
         }
-        else if (config.workload_type == "compute_prime")
+        metrics.total_requests.fetch_add(1, memory_order_relaxed);
+
+        // Send request and measure response time
+        int status;
+        if (config.binary)
         {
-            // CPU-intensive: compute prime numbers
-            method = "GET";
-            path = "/compute/prime";
-            uniform_int_distribution<int> dist(100, 1000);
-            int count = dist(wg.rng);
-            params = "count=" + to_string(count);
+            success = binary_client.send_request(method, path, params, response, response_time_ms);
+            status = binary_client.last_status();
         }
-        else if (config.workload_type == "compute_hash")
+        else
         {
-            // CPU-intensive: compute hash
-            method = "GET";
-            path = "/compute/hash";
-            params = "text=" + wg.random_value(100);
+            success = client.send_request(method, path, params, response, response_time_ms);
+            status = client.last_status();
         }
-        else if (config.workload_type == "compute_mixed")
+
+        if (open_loop)
         {
-            // Mixed compute workload: 60% hash, 40% prime
-            if (wg.random_double() < 0.6)
+            response_time_ms = duration_cast<microseconds>(high_resolution_clock::now() - intended).count() / 1000.0;
+        }
+        record(metrics, success, response_time_ms, Trace::route(method, path), status,
+               config.binary ? SRC_NONE : response_source(response.data(), response.size()));
+
+        // Closed loop: zero think time - immediately proceed to next request
+    }
+
+    cout << "[Thread " << thread_id << "] Stopped\n";
+}
+
+// Event-driven engine: each thread multiplexes its share of
+// config.connections non-blocking keep-alive connections with epoll, so
+// thousands of concurrent clients need only a few threads.
+// Closed loop: every connection sends its next request as soon as the last
+// one returns. Open loop: requests follow the thread's arrival schedule (or
+// its share of a replayed trace) and go to an idle connection, waiting in a
+// backlog while none is free.
+class EventWorker
+{
+private:
+    struct Conn
+    {
+        int fd = -1;
+        bool connected = false;
+        bool busy = false;    // a request is outstanding
+        bool idle = false;    // in the idle list (open loop)
+        bool retried = false; // current request was already retried once
+        bool want_out = true; // EPOLLOUT registered
+        int served = 0;       // responses on this socket
+        string out;           // current request
+        size_t sent = 0;
+        string in;
+        string method;
+        int route = Trace::OTHER;
+        high_resolution_clock::time_point start;    // latency measured from here
+        high_resolution_clock::time_point deadline; // connect or request timeout
+    };
+
+    static const uint32_t TIMER_ID = UINT32_MAX;
+    static constexpr size_t GENERATED = SIZE_MAX; // Arrival without a trace record
+
+    struct Arrival
+    {
+        high_resolution_clock::time_point t; // intended send time
+        size_t record;                       // trace record, or GENERATED
+    };
+
+    const Config &config;
+    ThreadMetrics &metrics;
+    WorkloadGenerator wg;
+    ArrivalSchedule schedule;
+    high_resolution_clock::time_point start;
+    bool open_loop;
+    size_t next_record; // replay: this thread sends records thread_id, +threads, ...
+    sockaddr_in addr;
+    int epfd;
+    int timer = -1; // fires at the next arrival (open loop)
+    vector<Conn> conns;
+    vector<int> idle;
+    deque<Arrival> backlog; // arrivals waiting for a connection
+    Arrival due;            // next arrival, t = max once a replay is done
+    int inflight = 0;       // busy connections
+    bool exhausted = false; // load phase: every record inserted
+
+    void set_events(int i, bool want_out)
+    {
+        Conn &c = conns[i];
+        if (c.want_out == want_out)
+            return;
+        epoll_event ev{};
+        ev.events = EPOLLIN | (want_out ? EPOLLOUT : 0);
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+        c.want_out = want_out;
+    }
+
+    // start a non-blocking connect, completion shows up as EPOLLOUT
+    bool open(int i)
+    {
+        Conn &c = conns[i];
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (c.fd < 0)
+            return false;
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        c.connected = false;
+        c.served = 0;
+        c.sent = 0;
+        c.in.clear();
+        if (!c.busy)
+            c.deadline = high_resolution_clock::now() + milliseconds(config.timeout_ms);
+
+        if (connect(c.fd, (sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+        {
+            close(c.fd);
+            c.fd = -1;
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+        c.want_out = true;
+        return true;
+    }
+
+    void disconnect(int i)
+    {
+        Conn &c = conns[i];
+        if (c.fd >= 0)
+            close(c.fd);
+        c.fd = -1;
+        c.connected = false;
+        c.idle = false;
+        c.in.clear();
+    }
+
+    // the connection can take a request
+    void ready(int i)
+    {
+        Conn &c = conns[i];
+        if (!c.connected || c.busy)
+            return;
+        if (!open_loop)
+        {
+            begin(i, {high_resolution_clock::now(), GENERATED});
+        }
+        else if (!backlog.empty())
+        {
+            Arrival a = backlog.front();
+            backlog.pop_front();
+            begin(i, a);
+        }
+        else if (!c.idle)
+        {
+            c.idle = true;
+            idle.push_back(i);
+        }
+    }
+
+    void begin(int i, const Arrival &a)
+    {
+        Conn &c = conns[i];
+        string path, params;
+        if (a.record != GENERATED)
+        {
+            config.replay->request(a.record, c.method, path, params);
+        }
+        else if (!wg.next(c.method, path, params))
+        {
+            exhausted = true;
+            return;
+        }
+        c.route = Trace::route(c.method, path);
+        c.out = c.method + " " + path;
+        if (!params.empty())
+            c.out += "?" + params;
+        c.out += " HTTP/1.1\r\nHost: " + config.server_host + "\r\nContent-Length: 0\r\n\r\n";
+
+        c.sent = 0;
+        c.busy = true;
+        inflight++;
+        c.retried = false;
+        c.start = a.t;
+        c.deadline = high_resolution_clock::now() + milliseconds(config.timeout_ms);
+        flush(i);
+    }
+
+    void flush(int i)
+    {
+        Conn &c = conns[i];
+        while (c.sent < c.out.size())
+        {
+            ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    set_events(i, true);
+                else
+                    lost(i);
+                return;
+            }
+            c.sent += n;
+        }
+        set_events(i, false);
+    }
+
+    // status 0 = no response
+    void complete(int i, bool success, int status = 0, int source = SRC_NONE)
+    {
+        Conn &c = conns[i];
+        c.busy = false;
+        inflight--;
+        metrics.total_requests.fetch_add(1, memory_order_relaxed);
+        record(metrics, success, duration_cast<microseconds>(high_resolution_clock::now() - c.start).count() / 1000.0,
+               c.route, status, source);
+        ready(i);
+    }
+
+    // the connection broke. If it had already served responses and nothing
+    // of this one arrived, the server closed it while idle: retry once on a
+    // new connection (same rule as HTTPClient)
+    void lost(int i)
+    {
+        Conn &c = conns[i];
+        bool retry = c.busy && c.served > 0 && c.in.empty() && !c.retried;
+        disconnect(i);
+        if (retry)
+        {
+            c.retried = true;
+            if (!open(i))
+                complete(i, false);
+            return;
+        }
+        if (c.busy)
+            complete(i, false);
+        open(i);
+    }
+
+    void on_event(int i, uint32_t events)
+    {
+        Conn &c = conns[i];
+        if (c.fd < 0)
+            return;
+
+        if (!c.connected)
+        {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err || (events & (EPOLLERR | EPOLLHUP)))
             {
-                method = "GET";
-                path = "/compute/hash";
-                params = "text=" + wg.random_value(100);
+                // leave it closed, scan() reconnects later instead of spinning
+                disconnect(i);
+                if (c.busy)
+                    complete(i, false);
+                return;
             }
+            c.connected = true;
+            if (c.busy)
+                flush(i);
             else
             {
-                method = "GET";
-                path = "/compute/prime";
-                uniform_int_distribution<int> dist(100, 1000);
-                int count = dist(wg.rng);
-                params = "count=" + to_string(count);
+                set_events(i, false);
+                ready(i);
             }
+            return;
         }
-        else if (config.workload_type == "mixed")
+
+        if ((events & EPOLLOUT) && c.busy && c.sent < c.out.size())
+            flush(i);
+        if (c.fd >= 0 && (events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+            receive(i);
+    }
+
+    void receive(int i)
+    {
+        Conn &c = conns[i];
+        char chunk[16384];
+        bool eof = false;
+        for (;;)
         {
-            // Mixed workload: 70% reads, 20% creates, 10% deletes
-            double rand = wg.random_double();
-            if (rand < 0.70)
+            ssize_t n = recv(c.fd, chunk, sizeof(chunk), 0);
+            if (n > 0)
             {
-                // 70% reads
-                method = "GET";
-                path = "/kv/read";
-                // Mix of popular and random keys
-                if (wg.random_double() < 0.3)
-                {
-                    params = "key=" + wg.popular_key(20);
-                }
-                else
-                {
-                    params = "key=" + wg.random_key();
-                }
+                c.in.append(chunk, n);
+                continue;
             }
-            else if (rand < 0.90)
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            eof = true; // closed or reset
+            break;
+        }
+
+        if (!c.busy)
+        {
+            // idle connection closed by the server (timeout, request limit)
+            if (eof)
             {
-                // 20% creates
-                method = "POST";
-                path = "/kv/create";
-                params = "key=" + wg.random_key() + "&value=" + wg.random_value();
+                disconnect(i);
+                open(i);
             }
-            else
+            return;
+        }
+
+        size_t consumed;
+        int status;
+        bool server_closes;
+        int r = parse_http_response(c.in, eof, consumed, status, server_closes, nullptr);
+        if (r == 0 && !eof)
+            return;
+        if (r <= 0)
+        {
+            lost(i);
+            return;
+        }
+
+        int source = response_source(c.in.data(), consumed);
+        c.in.erase(0, consumed);
+        c.served++;
+        // 2xx, or 404 for gets, is acceptable (same rule as HTTPClient)
+        bool success = (status >= 200 && status < 300) || (c.method == "GET" && status == 404);
+        if (server_closes || eof)
+        {
+            disconnect(i);
+            open(i);
+        }
+        complete(i, success, status, source);
+    }
+
+    // next arrival: the thread's next trace record, or from the schedule
+    void advance()
+    {
+        if (!config.replay)
+        {
+            due = {schedule.take(wg.rng), GENERATED};
+            return;
+        }
+        if (next_record >= config.replay->size())
+        {
+            due = {high_resolution_clock::time_point::max(), GENERATED}; // trace done
+            return;
+        }
+        due = {start + microseconds(config.replay->offset_us(next_record)), next_record};
+        next_record += config.num_threads;
+    }
+
+    // open-loop arrivals up to now go to idle connections or the backlog
+    void arrivals()
+    {
+        auto now = high_resolution_clock::now();
+        while (due.t <= now)
+        {
+            backlog.push_back(due);
+            advance();
+        }
+        while (!backlog.empty() && !idle.empty())
+        {
+            int i = idle.back();
+            idle.pop_back();
+            if (!conns[i].idle)
+                continue; // closed since it was listed
+            conns[i].idle = false;
+            Arrival a = backlog.front();
+            backlog.pop_front();
+            begin(i, a);
+        }
+
+        itimerspec ts{}; // all zero disarms
+        if (due.t == high_resolution_clock::time_point::max())
+        {
+            timerfd_settime(timer, 0, &ts, nullptr);
+            return;
+        }
+        long ns = duration_cast<nanoseconds>(due.t - now).count();
+        ts.it_value.tv_sec = ns / 1000000000;
+        ts.it_value.tv_nsec = max(1L, ns % 1000000000);
+        timerfd_settime(timer, 0, &ts, nullptr);
+    }
+
+    // reconnect closed connections and time out stuck ones
+    void scan()
+    {
+        auto now = high_resolution_clock::now();
+        for (int i = 0; i < (int)conns.size(); i++)
+        {
+            Conn &c = conns[i];
+            if (c.fd < 0)
+            {
+                if (!open(i) && c.busy)
+                    complete(i, false);
+                continue;
+            }
+            if ((c.busy || !c.connected) && now > c.deadline)
             {
-                // 10% deletes
-                method = "DELETE";
-                path = "/kv/delete";
-                params = "key=" + wg.random_key();
+                disconnect(i);
+                if (c.busy)
+                    complete(i, false);
             }
         }
-        else
+    }
+
+    // nothing left to send and every response is in
+    bool finished() const
+    {
+        bool done = exhausted || (config.replay && due.t == high_resolution_clock::time_point::max());
+        return done && backlog.empty() && inflight == 0;
+    }
+
+public:
+    EventWorker(int thread_id, const Config &cfg, ThreadMetrics &m, high_resolution_clock::time_point run_start)
+        : config(cfg), metrics(m), wg(thread_id, cfg), schedule(cfg, thread_id, run_start),
+          start(run_start), open_loop(cfg.rate > 0 || cfg.replay), next_record(thread_id)
+    {
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config.server_port);
+        inet_pton(AF_INET, config.server_host.c_str(), &addr.sin_addr);
+
+        // this thread's share of the connections
+        int n = config.connections / config.num_threads +
+                (thread_id < config.connections % config.num_threads ? 1 : 0);
+        conns.resize(n);
+
+        epfd = epoll_create1(0);
+        if (open_loop)
         {
-            // Default to get_all
-            method = "GET";
-            path = "/kv/read";
-            params = "key=" + wg.random_key();
+            timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = TIMER_ID;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, timer, &ev);
+            advance();
         }
+    }
 
-        // Send request and measure response time
-        success = client.send_request(method, path, params, response, response_time_ms);
+    ~EventWorker()
+    {
+        for (int i = 0; i < (int)conns.size(); i++)
+            disconnect(i);
+        if (timer >= 0)
+            close(timer);
+        close(epfd);
+    }
 
-        if (success)
-        {
-            metrics.successful_requests++;
-            metrics.total_response_time_ms += (uint64_t)response_time_ms;
+    size_t size() const { return conns.size(); }
 
-            // Store individual response time for detailed analysis
+    void run(atomic<bool> &should_stop)
+    {
+        for (int i = 0; i < (int)conns.size(); i++)
+            open(i);
+        if (open_loop)
+            arrivals();
+
+        vector<epoll_event> events(1024);
+        auto last_scan = high_resolution_clock::now();
+        while (!should_stop.load())
+        {
+            int n = epoll_wait(epfd, events.data(), events.size(), 100);
+            for (int k = 0; k < n; k++)
+            {
+                if (events[k].data.u32 == TIMER_ID)
+                {
+                    uint64_t expirations;
+                    ssize_t r = read(timer, &expirations, sizeof(expirations));
+                    (void)r;
+                    continue;
+                }
+                on_event(events[k].data.u32, events[k].events);
+            }
+            if (exhausted)
+                backlog.clear();
+            else if (open_loop)
+                arrivals();
+            if (finished())
+                break;
+
+            auto now = high_resolution_clock::now();
+            if (now - last_scan >= milliseconds(100))
             {
-                lock_guard<mutex> lock(metrics.mtx);
-                metrics.response_times.push_back(response_time_ms);
+                scan();
+                last_scan = now;
             }
         }
-        else
-        {
-            metrics.failed_requests++;
-        }
-
-        // Zero think time - immediately proceed to next request
     }
+};
 
+// Event thread function: runs one EventWorker until stopped
+void event_thread(int thread_id, const Config &config, ThreadMetrics &metrics,
+                  atomic<bool> &should_stop, high_resolution_clock::time_point start)
+{
+    EventWorker worker(thread_id, config, metrics, start);
+    cout << "[Thread " << thread_id << "] Started (" << worker.size() << " connections)\n";
+    worker.run(should_stop);
     cout << "[Thread " << thread_id << "] Stopped\n";
 }
 
@@ -364,23 +1561,76 @@ void print_usage(const char *program_name)
     cout << "  -p PORT          Server port (default: 8080)\n";
     cout << "  -t THREADS       Number of client threads (default: 1)\n";
     cout << "  -d DURATION      Test duration in seconds (default: 60)\n";
-    cout << "  -w WORKLOAD      Workload type (default: get_all)\n";
-    cout << "                   Options: get_all, put_all, get_popular, mixed,\n";
-    cout << "                            compute_prime, compute_hash, compute_mixed\n";
+    cout << "  -w WORKLOAD      Built-in workload or a workload spec file (default: get_all)\n";
+    cout << "                   Built-in: get_all, put_all, get_popular, mixed,\n";
+    cout << "                             compute_prime, compute_hash, compute_mixed,\n";
+    cout << "                             ycsb_a, ycsb_b, ycsb_c, ycsb_d, ycsb_e, ycsb_f\n";
+    cout << "  --phase P        load: insert the record set (--keys) and stop, -d defaults\n";
+    cout << "                   to unlimited; run: the operation mix (default: the spec's)\n";
+    cout << "  --value-size N   Every value N bytes, instead of the workload's sizes\n";
+    cout << "  --preload        Fill key_0 .. key_<keys-1> before the run (untimed), so\n";
+    cout << "                   reads find real rows instead of 404s\n";
+    cout << "  --preload-batch N Rows per /kv/bulk_load request (default: 1000),\n";
+    cout << "                   0 = one /kv/create per key\n";
     cout << "  --timeout MS     Socket timeout in milliseconds (default: 5000)\n";
+    cout << "  --binary         Use the binary kv protocol (kv workloads only)\n";
+    cout << "  --binary-port P  Binary protocol port (default: 9090)\n";
+    cout << "  --keep-alive     Reuse one HTTP connection per thread (default: new\n";
+    cout << "                   connection per request, Connection: close)\n";
+    cout << "  --connections N  Event-driven mode: N concurrent keep-alive connections\n";
+    cout << "                   multiplexed with epoll over the -t threads\n";
+    cout << "  --pipeline N     Pipeline N requests per keep-alive connection\n";
+    cout << "                   (use with -p 8081, the server's pipelined listener)\n";
+    cout << "\nKeys (key_N for reads, creates and deletes):\n";
+    cout << "  --key-dist D     uniform (default), zipfian, scrambled (zipfian with the\n";
+    cout << "                   hot keys spread out), latest (recently created keys\n";
+    cout << "                   are hot) or hotspot\n";
+    cout << "  --keys N         Key space size (default: 1000000)\n";
+    cout << "  --zipf-theta T   Skew for zipfian/scrambled/latest, 0 < T < 1 (default: 0.99)\n";
+    cout << "  --hot-keys F     hotspot: fraction of keys that are hot (default: 0.2)\n";
+    cout << "  --hot-ops F      hotspot: fraction of requests to hot keys (default: 0.8)\n";
+    cout << "  --popular-keys N Size of the popular_key set for get_popular/mixed\n";
+    cout << "                   (default: 10 and 20)\n";
+    cout << "\nTrace replay (a trace recorded by the server's trace_file option):\n";
+    cout << "  --replay FILE    Send the trace's requests at their recorded times instead\n";
+    cout << "                   of -w; -t threads (or --connections) share them\n";
+    cout << "  --replay-speed X Replay X times faster than recorded (default: 1)\n";
+    cout << "                   -d defaults to the trace length\n";
+    cout << "\nOpen loop (latency measured from each request's intended send time):\n";
+    cout << "  --rate R         Send R req/s in total instead of back to back\n";
+    cout << "                   (-t threads share the rate; use enough threads to keep up)\n";
+    cout << "  --arrival A      Inter-arrival times: poisson (default) or constant\n";
+    cout << "  --sweep          Run -d seconds per step, starting at --rate (default 1000)\n";
+    cout << "                   and multiplying it until the server saturates\n";
+    cout << "  --sweep-factor F Rate multiplier per step (default: 1.25)\n";
+    cout << "  --sweep-max R    Highest rate to try (default: 1000000)\n";
+    cout << "  --slo-ms MS      p99 bound for a step to pass (default: 10x the first step's p99)\n";
+    cout << "\nResult files:\n";
+    cout << "  --csv FILE       Write a 1 s time series (throughput, failures, avg and max latency)\n";
+    cout << "  --json FILE      Write all results: totals, per-route latency, status codes,\n";
+    cout << "                   response sources and the time series\n";
     cout << "\nWorkload descriptions:\n";
     cout << "  get_all        - Read requests with unique keys (cache misses, disk-bound)\n";
     cout << "  put_all        - Create/delete requests (disk-bound)\n";
     cout << "  get_popular    - Read requests with popular keys (cache hits, CPU/memory-bound)\n";
-    cout << "  mixed          - 70% reads, 20% creates, 10% deletes\n";
+    cout << "  mixed          - 70% reads (30% of them popular), 20% creates, 10% deletes\n";
     cout << "  compute_prime  - CPU-intensive prime number computation\n";
     cout << "  compute_hash   - CPU-intensive hash computation\n";
     cout << "  compute_mixed  - Mixed compute workload (60% hash, 40% prime)\n";
+    cout << "  ycsb_a .. f    - YCSB core workloads A-F, 1 KB values, zipfian keys:\n";
+    cout << "                   A 50/50 read/update, B 95/5 read/update, C read only,\n";
+    cout << "                   D 95/5 read/insert (latest), E 95/5 scan/insert, F 50/50\n";
+    cout << "                   read/read-modify-write\n";
+    cout << "Spec files hold YCSB properties (readproportion = 0.5, ...), see README.md\n";
 }
 
 // Parse command line arguments
 bool parse_args(int argc, char *argv[], Config &config)
 {
+    // key settings given here win over the workload spec's
+    bool key_dist_set = false, keys_set = false, theta_set = false;
+    bool hot_keys_set = false, hot_ops_set = false, popular_set = false;
+
     for (int i = 1; i < argc; i++)
     {
         string arg = argv[i];
@@ -400,15 +1650,122 @@ bool parse_args(int argc, char *argv[], Config &config)
         else if (arg == "-d" && i + 1 < argc)
         {
             config.duration_seconds = stoi(argv[++i]);
+            config.duration_set = true;
         }
         else if (arg == "-w" && i + 1 < argc)
         {
             config.workload_type = argv[++i];
         }
+        else if (arg == "--phase" && i + 1 < argc)
+        {
+            config.phase = argv[++i];
+        }
+        else if (arg == "--value-size" && i + 1 < argc)
+        {
+            config.value_size = stoi(argv[++i]);
+        }
+        else if (arg == "--preload")
+        {
+            config.preload = true;
+        }
+        else if (arg == "--preload-batch" && i + 1 < argc)
+        {
+            config.preload_batch = stoi(argv[++i]);
+        }
         else if (arg == "--timeout" && i + 1 < argc)
         {
             config.timeout_ms = stoi(argv[++i]);
         }
+        else if (arg == "--binary")
+        {
+            config.binary = true;
+        }
+        else if (arg == "--binary-port" && i + 1 < argc)
+        {
+            config.binary_port = stoi(argv[++i]);
+        }
+        else if (arg == "--keep-alive")
+        {
+            config.keep_alive = true;
+        }
+        else if (arg == "--connections" && i + 1 < argc)
+        {
+            config.connections = stoi(argv[++i]);
+        }
+        else if (arg == "--key-dist" && i + 1 < argc)
+        {
+            config.key_dist = argv[++i];
+            key_dist_set = true;
+        }
+        else if (arg == "--keys" && i + 1 < argc)
+        {
+            config.key_count = stol(argv[++i]);
+            keys_set = true;
+        }
+        else if (arg == "--zipf-theta" && i + 1 < argc)
+        {
+            config.zipf_theta = stod(argv[++i]);
+            theta_set = true;
+        }
+        else if (arg == "--hot-keys" && i + 1 < argc)
+        {
+            config.hot_keys = stod(argv[++i]);
+            hot_keys_set = true;
+        }
+        else if (arg == "--hot-ops" && i + 1 < argc)
+        {
+            config.hot_ops = stod(argv[++i]);
+            hot_ops_set = true;
+        }
+        else if (arg == "--popular-keys" && i + 1 < argc)
+        {
+            config.popular_keys = stoi(argv[++i]);
+            popular_set = true;
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            config.replay_file = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc)
+        {
+            config.replay_speed = stod(argv[++i]);
+        }
+        else if (arg == "--pipeline" && i + 1 < argc)
+        {
+            config.pipeline = stoi(argv[++i]);
+        }
+        else if (arg == "--rate" && i + 1 < argc)
+        {
+            config.rate = stod(argv[++i]);
+        }
+        else if (arg == "--arrival" && i + 1 < argc)
+        {
+            config.arrival = argv[++i];
+        }
+        else if (arg == "--sweep")
+        {
+            config.sweep = true;
+        }
+        else if (arg == "--sweep-factor" && i + 1 < argc)
+        {
+            config.sweep_factor = stod(argv[++i]);
+        }
+        else if (arg == "--sweep-max" && i + 1 < argc)
+        {
+            config.sweep_max = stod(argv[++i]);
+        }
+        else if (arg == "--slo-ms" && i + 1 < argc)
+        {
+            config.slo_ms = stod(argv[++i]);
+        }
+        else if (arg == "--csv" && i + 1 < argc)
+        {
+            config.csv_file = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc)
+        {
+            config.json_file = argv[++i];
+        }
         else if (arg == "--help")
         {
             return false;
@@ -420,58 +1777,262 @@ bool parse_args(int argc, char *argv[], Config &config)
         }
     }
 
-    // Validate workload type
-    if (config.workload_type != "get_all" &&
-        config.workload_type != "put_all" &&
-        config.workload_type != "get_popular" &&
-        config.workload_type != "mixed" &&
-        config.workload_type != "compute_prime" &&
-        config.workload_type != "compute_hash" &&
-        config.workload_type != "compute_mixed")
+    // Compile the workload: a built-in name or a spec file
+    string spec_err;
+    config.spec = make_shared<WorkloadSpec>();
+    if (!WorkloadSpec::load(config.workload_type, *config.spec, spec_err))
+    {
+        cerr << spec_err << "\n";
+        return false;
+    }
+    if (config.value_size < 0 || config.value_size > 7000)
+    {
+        cerr << "--value-size must be 0-7000 (values travel in the query string)\n";
+        return false;
+    }
+    if (config.value_size > 0)
+    {
+        config.spec->value_distribution = "constant";
+        config.spec->value_max = config.value_size;
+        config.spec->field_count = 1;
+    }
+    const WorkloadSpec &spec = *config.spec;
+    if (!spec.request_distribution.empty() && !key_dist_set)
+        config.key_dist = spec.request_distribution;
+    if (spec.record_count > 0 && !keys_set)
+        config.key_count = spec.record_count;
+    if (spec.zipf_theta > 0 && !theta_set)
+        config.zipf_theta = spec.zipf_theta;
+    if (spec.hot_keys > 0 && !hot_keys_set)
+        config.hot_keys = spec.hot_keys;
+    if (spec.hot_ops > 0 && !hot_ops_set)
+        config.hot_ops = spec.hot_ops;
+    if (spec.popular_keys > 0 && !popular_set)
+        config.popular_keys = spec.popular_keys;
+
+    if (config.phase.empty())
+        config.phase = spec.load_phase ? "load" : "run";
+    if (config.phase != "load" && config.phase != "run")
+    {
+        cerr << "--phase must be load or run\n";
+        return false;
+    }
+    if (config.phase == "load" && (config.sweep || !config.replay_file.empty()))
+    {
+        cerr << "--phase load cannot be combined with --sweep or --replay\n";
+        return false;
+    }
+    if (config.preload && (!config.replay_file.empty() || config.preload_batch < 0))
+    {
+        cerr << "--preload fills key_N keys, it cannot be combined with --replay; --preload-batch must be >= 0\n";
+        return false;
+    }
+    // the load phase runs until every record is in, unless -d says otherwise
+    if (config.phase == "load" && !config.duration_set)
+        config.duration_seconds = INT_MAX / 2;
+
+    // The binary protocol only covers read, create and delete
+    if (config.binary && !spec.kv_basic())
+    {
+        cerr << "Workload " << config.workload_type << " is not supported with --binary\n";
+        return false;
+    }
+
+    // The pipelined listener only serves those routes too
+    if (config.pipeline > 1 && (config.binary || !spec.kv_basic()))
+    {
+        cerr << "--pipeline works with HTTP kv workloads only\n";
+        return false;
+    }
+    if (config.pipeline < 1)
+    {
+        cerr << "--pipeline must be at least 1\n";
+        return false;
+    }
+
+    // The event engine speaks HTTP/1.1 keep-alive, one request in flight per connection
+    if (config.connections < 0 || (config.connections > 0 && (config.binary || config.pipeline > 1)))
+    {
+        cerr << "--connections cannot be combined with --binary or --pipeline\n";
+        return false;
+    }
+    if (config.connections > 0 && config.connections < config.num_threads)
+    {
+        cerr << "--connections must be at least the number of threads\n";
+        return false;
+    }
+
+    KeyDistribution::Type key_type;
+    if (!KeyDistribution::parse(config.key_dist, key_type))
+    {
+        cerr << "Invalid key distribution: " << config.key_dist << "\n";
+        return false;
+    }
+    if (config.key_count < 1 || config.popular_keys < 0 ||
+        config.zipf_theta <= 0 || config.zipf_theta >= 1 ||
+        config.hot_keys <= 0 || config.hot_keys > 1 || config.hot_ops < 0 || config.hot_ops > 1)
+    {
+        cerr << "--keys must be positive, --zipf-theta in (0, 1), --hot-keys in (0, 1], --hot-ops in [0, 1]\n";
+        return false;
+    }
+    config.keys = make_shared<KeyDistribution>(key_type, config.key_count, config.zipf_theta,
+                                               config.hot_keys, config.hot_ops);
+
+    if (!config.replay_file.empty())
+    {
+        if (config.rate > 0 || config.sweep || config.pipeline > 1 || config.binary)
+        {
+            cerr << "--replay sets its own schedule, it cannot be combined with --rate, --sweep, --pipeline or --binary\n";
+            return false;
+        }
+        if (config.replay_speed <= 0)
+        {
+            cerr << "--replay-speed must be positive\n";
+            return false;
+        }
+        string err;
+        config.replay = make_shared<TraceReplay>();
+        if (!config.replay->load(config.replay_file, config.replay_speed, err))
+        {
+            cerr << err << "\n";
+            return false;
+        }
+        if (!config.duration_set)
+            config.duration_seconds = (int)ceil(config.replay->span_s()) + 1;
+    }
+
+    if (config.sweep && config.rate <= 0)
+        config.rate = 1000;
+    if (config.rate < 0 || (config.arrival != "poisson" && config.arrival != "constant"))
+    {
+        cerr << "--rate must be positive and --arrival poisson or constant\n";
+        return false;
+    }
+    if (config.rate > 0 && config.pipeline > 1)
+    {
+        cerr << "--rate cannot be combined with --pipeline\n";
+        return false;
+    }
+    if (config.sweep && config.sweep_factor <= 1.0)
+    {
+        cerr << "--sweep-factor must be greater than 1\n";
+        return false;
+    }
+    if (config.sweep && (!config.csv_file.empty() || !config.json_file.empty()))
     {
-        cerr << "Invalid workload type: " << config.workload_type << "\n";
+        cerr << "--csv and --json describe a single run, they cannot be combined with --sweep\n";
         return false;
     }
 
     return true;
 }
 
-// Calculate percentile
-double calculate_percentile(vector<double> &data, double percentile)
+// Fill key_0 .. key_<keys-1> before the measured run, untimed. Each thread
+// sends its share of the batches (rows b*batch .. b*batch+batch-1 for
+// b = thread, thread + threads, ...) to /kv/bulk_load on one keep-alive
+// connection, or one /kv/create per key with --preload-batch 0. Values
+// follow the workload's value sizes.
+void preload(const Config &config)
 {
-    if (data.empty())
-        return 0.0;
+    uint64_t n = config.keys->size();
+    // the pipelined listener serves only read, create and delete
+    int batch = config.pipeline > 1 ? 0 : config.preload_batch;
+    uint64_t step = batch > 0 ? batch : 1;
+    atomic<uint64_t> loaded(0), failed(0);
+    atomic<int> active(config.num_threads);
+
+    cout << "Preloading " << n << " records ("
+         << (batch > 0 ? to_string(batch) + " per /kv/bulk_load request" : string("one /kv/create each")) << ")...\n";
+    auto start = high_resolution_clock::now();
+
+    vector<thread> threads;
+    for (int t = 0; t < config.num_threads; t++)
+    {
+        threads.emplace_back([&, t]
+                             {
+            // a batch is one db insert per bulk_batch rows, give it longer than a single request
+            HTTPClient client(config.server_host, config.server_port,
+                              batch > 0 ? max(config.timeout_ms, 60000) : config.timeout_ms, true);
+            WorkloadGenerator wg(t, config);
+            string response;
+            double ms;
+            for (uint64_t first = t * step; first < n; first += step * config.num_threads)
+            {
+                uint64_t last = min(n, first + step);
+                bool ok;
+                if (batch > 0)
+                {
+                    // values are alphanumeric, nothing to escape
+                    string body;
+                    for (uint64_t id = first; id < last; id++)
+                        body += "key_" + to_string(id) + "\t" + wg.spec_value() + "\n";
+                    ok = client.send_request("POST", "/kv/bulk_load", "", response, ms, body);
+                }
+                else
+                {
+                    ok = client.send_request("POST", "/kv/create", "key=key_" + to_string(first) + "&value=" + wg.spec_value(),
+                                             response, ms);
+                }
+                (ok ? loaded : failed) += last - first;
+            }
+            active--; });
+    }
 
-    sort(data.begin(), data.end());
-    size_t index = (size_t)(percentile / 100.0 * data.size());
-    if (index >= data.size())
-        index = data.size() - 1;
+    int elapsed = 0;
+    while (active.load() > 0)
+    {
+        this_thread::sleep_for(milliseconds(100));
+        int now_s = (int)duration_cast<seconds>(high_resolution_clock::now() - start).count();
+        if (now_s < elapsed + 10)
+            continue;
+        elapsed = now_s;
+        cout << "[" << elapsed << "s] Preloaded: " << loaded.load() << " / " << n << "\n";
+    }
+    for (auto &t : threads)
+        t.join();
 
-    return data[index];
+    double secs = duration_cast<milliseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+    cout << "Preloaded " << loaded.load() << " records in " << fixed << setprecision(2) << secs << " s ("
+         << setprecision(0) << loaded.load() / max(secs, 0.001) << " records/s)\n";
+    if (failed.load())
+        cerr << "Warning: " << failed.load() << " records failed to load, the run continues without them\n";
+    cout << "\n";
 }
 
-int main(int argc, char *argv[])
+// Results of one load run
+struct RunResult
 {
-    Config config;
+    double duration = 0;
+    uint64_t total = 0, success = 0, failed = 0;
+    double throughput = 0, success_rate = 0, avg_ms = 0;
+    double p50 = 0, p90 = 0, p95 = 0, p99 = 0, p999 = 0, p9999 = 0, max = 0;
 
-    if (!parse_args(argc, argv, config))
+    // routes that saw requests, latency of the successful ones in ms
+    struct Route
     {
-        print_usage(argv[0]);
-        return 1;
-    }
-
-    cout << "========================================\n";
-    cout << "  KV Store Load Generator\n";
-    cout << "========================================\n";
-    cout << "Server:    " << config.server_host << ":" << config.server_port << "\n";
-    cout << "Threads:   " << config.num_threads << "\n";
-    cout << "Duration:  " << config.duration_seconds << " seconds\n";
-    cout << "Workload:  " << config.workload_type << "\n";
-    cout << "Timeout:   " << config.timeout_ms << " ms\n";
-    cout << "========================================\n\n";
+        int route;
+        uint64_t ok, failed;
+        double avg_ms, p50, p99, p999, max;
+    };
+    vector<Route> routes;
+    vector<pair<int, uint64_t>> statuses; // (status, count), 0 = no response
+    uint64_t sources[SOURCES] = {};
+
+    // one point per second; latency of the successful requests in it
+    struct Point
+    {
+        double t; // end of the interval, seconds since the start
+        uint64_t success, failed;
+        double throughput, avg_ms, max_ms;
+    };
+    vector<Point> series;
+};
 
+// Run the configured load for config.duration_seconds
+RunResult run_load(const Config &config, bool progress)
+{
     // Initialize metrics
-    Metrics metrics;
+    Metrics metrics(config.num_threads);
     atomic<bool> should_stop(false);
 
     // Start worker threads
@@ -480,23 +2041,65 @@ int main(int argc, char *argv[])
 
     cout << "Starting " << config.num_threads << " client threads...\n";
 
+    // workers return early once a load phase or a replay has nothing left to send
+    auto worker = config.connections > 0 ? event_thread : worker_thread;
+    atomic<int> active(config.num_threads);
     for (int i = 0; i < config.num_threads; i++)
     {
-        threads.emplace_back(worker_thread, i, ref(config), ref(metrics), ref(should_stop));
+        threads.emplace_back([&, i]
+                             {
+            worker(i, config, metrics.threads[i], should_stop, start_time);
+            active--; });
     }
 
-    cout << "Load test running for " << config.duration_seconds << " seconds...\n";
-    cout << "Press Ctrl+C to stop early\n\n";
-
-    // Progress reporting
+    if (config.phase == "load" && !config.duration_set)
+        cout << "Loading " << config.keys->size() << " records...\n";
+    else
+        cout << "Load test running for " << config.duration_seconds << " seconds...\n";
+    if (progress)
+        cout << "Press Ctrl+C to stop early\n\n";
+
+    // Time series point every second, progress line every 10
+    RunResult r;
+    auto last_point = start_time;
+    uint64_t last_success = 0, last_failed = 0;
+    auto add_point = [&](high_resolution_clock::time_point now)
+    {
+        RunResult::Point pt;
+        double span = duration_cast<microseconds>(now - last_point).count() / 1e6;
+        uint64_t success = metrics.successful(), failed = metrics.failed();
+        uint64_t count, sum_us;
+        int64_t max_us;
+        metrics.take_interval(count, sum_us, max_us);
+        pt.t = duration_cast<microseconds>(now - start_time).count() / 1e6;
+        pt.success = success - last_success;
+        pt.failed = failed - last_failed;
+        pt.throughput = pt.success / span;
+        pt.avg_ms = count ? sum_us / 1000.0 / count : 0;
+        pt.max_ms = max_us / 1000.0;
+        r.series.push_back(pt);
+        last_point = now;
+        last_success = success;
+        last_failed = failed;
+    };
+
+    auto deadline = start_time + seconds(config.duration_seconds);
     int elapsed = 0;
-    while (elapsed < config.duration_seconds)
+    while (active.load() > 0 && high_resolution_clock::now() < deadline)
     {
-        this_thread::sleep_for(seconds(10));
-        elapsed += 10;
-
-        uint64_t current_success = metrics.successful_requests.load();
-        uint64_t current_failed = metrics.failed_requests.load();
+        this_thread::sleep_for(milliseconds(100));
+        auto now = high_resolution_clock::now();
+        if (now - last_point >= seconds(1))
+            add_point(now);
+        int now_s = (int)duration_cast<seconds>(now - start_time).count();
+        if (now_s < elapsed + 10)
+            continue;
+        elapsed = now_s;
+        if (!progress)
+            continue;
+
+        uint64_t current_success = metrics.successful();
+        uint64_t current_failed = metrics.failed();
         double current_throughput = (double)current_success / elapsed;
 
         cout << "[" << elapsed << "s] "
@@ -516,42 +2119,327 @@ int main(int argc, char *argv[])
     }
 
     auto end_time = high_resolution_clock::now();
-    double actual_duration = duration_cast<milliseconds>(end_time - start_time).count() / 1000.0;
+    if (end_time - last_point >= milliseconds(100))
+        add_point(end_time); // the last partial second
 
     // Calculate metrics
-    uint64_t total_req = metrics.total_requests.load();
-    uint64_t success_req = metrics.successful_requests.load();
-    uint64_t failed_req = metrics.failed_requests.load();
-    uint64_t total_resp_time = metrics.total_response_time_ms.load();
+    r.duration = duration_cast<milliseconds>(end_time - start_time).count() / 1000.0;
+    r.total = metrics.total();
+    r.success = metrics.successful();
+    r.failed = metrics.failed();
+
+    r.throughput = r.success / r.duration;
+    r.success_rate = r.total > 0 ? (double)r.success / r.total * 100.0 : 0.0;
+
+    // Percentiles from the merged histograms (us -> ms)
+    Histogram latency = metrics.merged();
+    r.avg_ms = latency.mean() / 1000.0;
+    r.p50 = latency.percentile(50) / 1000.0;
+    r.p90 = latency.percentile(90) / 1000.0;
+    r.p95 = latency.percentile(95) / 1000.0;
+    r.p99 = latency.percentile(99) / 1000.0;
+    r.p999 = latency.percentile(99.9) / 1000.0;
+    r.p9999 = latency.percentile(99.99) / 1000.0;
+    r.max = latency.max() / 1000.0;
+
+    for (int route = 0; route < Trace::ROUTES; route++)
+    {
+        RunResult::Route rr{route, 0, 0, 0, 0, 0, 0, 0};
+        for (auto &t : metrics.threads)
+        {
+            rr.ok += t.route_ok[route];
+            rr.failed += t.route_failed[route];
+        }
+        if (rr.ok + rr.failed == 0)
+            continue;
+        Histogram h = metrics.merged_route(route);
+        rr.avg_ms = h.mean() / 1000.0;
+        rr.p50 = h.percentile(50) / 1000.0;
+        rr.p99 = h.percentile(99) / 1000.0;
+        rr.p999 = h.percentile(99.9) / 1000.0;
+        rr.max = h.max() / 1000.0;
+        r.routes.push_back(rr);
+    }
+    for (int status = 0; status < MAX_STATUS; status++)
+    {
+        uint64_t n = 0;
+        for (auto &t : metrics.threads)
+            n += t.status_counts[status];
+        if (n)
+            r.statuses.push_back({status, n});
+    }
+    for (auto &t : metrics.threads)
+    {
+        for (int src = 0; src < SOURCES; src++)
+            r.sources[src] += t.source_counts[src];
+    }
+    return r;
+}
+
+// Time series as CSV, one row per second
+bool write_csv(const string &path, const RunResult &r)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    fprintf(f, "time_s,success,failed,throughput,avg_ms,max_ms\n");
+    for (auto &pt : r.series)
+    {
+        fprintf(f, "%.3f,%lu,%lu,%.2f,%.3f,%.3f\n", pt.t, (unsigned long)pt.success,
+                (unsigned long)pt.failed, pt.throughput, pt.avg_ms, pt.max_ms);
+    }
+    fclose(f);
+    return true;
+}
+
+// Whole result as JSON: totals, per route, statuses, sources and the time series
+bool write_json(const string &path, const Config &config, const RunResult &r)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    auto num = [](double v)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.3f", v);
+        return string(buf);
+    };
+
+    string json = "{\n";
+    json += "  \"workload\": \"" + (config.replay ? string("replay") : config.spec->name) + "\", ";
+    json += "\"threads\": " + to_string(config.num_threads) + ", ";
+    json += "\"duration_s\": " + num(r.duration) + ",\n";
+    json += "  \"total\": " + to_string(r.total) + ", \"success\": " + to_string(r.success) + ", ";
+    json += "\"failed\": " + to_string(r.failed) + ", \"throughput\": " + num(r.throughput) + ",\n";
+    json += "  \"latency_ms\": {\"avg\": " + num(r.avg_ms) + ", \"p50\": " + num(r.p50) + ", \"p90\": " + num(r.p90) +
+            ", \"p95\": " + num(r.p95) + ", \"p99\": " + num(r.p99) + ", \"p99.9\": " + num(r.p999) +
+            ", \"p99.99\": " + num(r.p9999) + ", \"max\": " + num(r.max) + "},\n";
+
+    json += "  \"routes\": {";
+    for (size_t i = 0; i < r.routes.size(); i++)
+    {
+        auto &rr = r.routes[i];
+        json += string(i ? "," : "") + "\n    \"" + Trace::name(rr.route) + "\": {\"ok\": " + to_string(rr.ok) +
+                ", \"failed\": " + to_string(rr.failed) + ", \"avg\": " + num(rr.avg_ms) + ", \"p50\": " + num(rr.p50) +
+                ", \"p99\": " + num(rr.p99) + ", \"p99.9\": " + num(rr.p999) + ", \"max\": " + num(rr.max) + "}";
+    }
+    json += "\n  },\n";
 
-    double throughput = success_req / actual_duration;
-    double avg_response_time = success_req > 0 ? (double)total_resp_time / success_req : 0.0;
-    double success_rate = total_req > 0 ? (double)success_req / total_req * 100.0 : 0.0;
+    json += "  \"statuses\": {";
+    for (size_t i = 0; i < r.statuses.size(); i++)
+    {
+        json += string(i ? ", " : "") + "\"" + (r.statuses[i].first ? to_string(r.statuses[i].first) : "none") +
+                "\": " + to_string(r.statuses[i].second);
+    }
+    json += "},\n";
+
+    json += "  \"sources\": {";
+    for (int src = 0; src < SOURCES; src++)
+        json += string(src ? ", " : "") + "\"" + source_name(src) + "\": " + to_string(r.sources[src]);
+    json += "},\n";
+
+    json += "  \"series\": [";
+    for (size_t i = 0; i < r.series.size(); i++)
+    {
+        auto &pt = r.series[i];
+        json += string(i ? "," : "") + "\n    {\"t\": " + num(pt.t) + ", \"success\": " + to_string(pt.success) +
+                ", \"failed\": " + to_string(pt.failed) + ", \"throughput\": " + num(pt.throughput) +
+                ", \"avg_ms\": " + num(pt.avg_ms) + ", \"max_ms\": " + num(pt.max_ms) + "}";
+    }
+    json += "\n  ]\n}\n";
+
+    fwrite(json.data(), 1, json.size(), f);
+    fclose(f);
+    return true;
+}
+
+// Open-loop rate sweep: raise the rate step by step and report the knee,
+// the highest rate the server sustained (>= 95% of target, p99 within SLO)
+int run_sweep(Config config)
+{
+    struct Step
+    {
+        double rate;
+        RunResult r;
+        bool ok;
+    };
+    vector<Step> steps;
+    double slo = config.slo_ms;
+
+    for (double rate = config.rate; rate <= config.sweep_max; rate *= config.sweep_factor)
+    {
+        config.rate = rate;
+        cout << "\n--- Sweep step: " << fixed << setprecision(0) << rate << " req/s ---\n";
+        RunResult r = run_load(config, false);
+
+        if (slo <= 0)
+            slo = max(10 * r.p99, 1.0); // first step sets the bound
+        bool ok = r.throughput >= 0.95 * rate && r.p99 <= slo;
+        steps.push_back({rate, r, ok});
+        cout << "Achieved " << fixed << setprecision(0) << r.throughput << " req/s, p99 "
+             << setprecision(2) << r.p99 << " ms -> " << (ok ? "ok" : "saturated") << "\n";
+        if (!ok)
+            break;
+    }
+
+    cout << "\n========================================\n";
+    cout << "  Rate Sweep Results (open loop, " << config.arrival << ")\n";
+    cout << "========================================\n";
+    cout << "p99 SLO: " << fixed << setprecision(2) << slo << " ms\n\n";
+    cout << setw(12) << "Target" << setw(12) << "Achieved" << setw(10) << "P50 ms"
+         << setw(10) << "P99 ms" << setw(10) << "P99.9 ms" << setw(10) << "Failed" << "  Status\n";
+    const Step *knee = nullptr;
+    for (auto &st : steps)
+    {
+        cout << setw(12) << setprecision(0) << st.rate << setw(12) << st.r.throughput
+             << setw(10) << setprecision(2) << st.r.p50 << setw(10) << st.r.p99
+             << setw(10) << st.r.p999 << setw(10) << st.r.failed << "  " << (st.ok ? "ok" : "saturated") << "\n";
+        if (st.ok)
+            knee = &st;
+    }
+    cout << "\n";
+    if (knee)
+        cout << "Saturation Knee:       " << fixed << setprecision(2) << knee->rate << " req/s (p99 "
+             << knee->r.p99 << " ms)\n";
+    else
+        cout << "Saturation Knee:       below the starting rate\n";
+    cout << "========================================\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Config config;
+
+    if (!parse_args(argc, argv, config))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // one fd per connection, the default soft limit is often 1024
+    if (config.connections > 0)
+    {
+        rlimit lim;
+        if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < (rlim_t)config.connections + 64)
+        {
+            lim.rlim_cur = min<rlim_t>(lim.rlim_max, config.connections + 64);
+            setrlimit(RLIMIT_NOFILE, &lim);
+            if (lim.rlim_cur < (rlim_t)config.connections + 64)
+                cerr << "Warning: open file limit " << lim.rlim_cur << " is below --connections\n";
+        }
+    }
+
+    cout << "========================================\n";
+    cout << "  KV Store Load Generator\n";
+    cout << "========================================\n";
+    cout << "Server:    " << config.server_host << ":" << config.server_port << "\n";
+    cout << "Threads:   " << config.num_threads << "\n";
+    if (config.phase == "load" && !config.duration_set)
+        cout << "Duration:  until all records are loaded\n";
+    else
+        cout << "Duration:  " << config.duration_seconds << " seconds\n";
+    if (config.replay)
+        cout << "Workload:  trace replay\n";
+    else if (config.phase == "load")
+        cout << "Workload:  " << config.spec->name << ", load phase (" << config.keys->size() << " records)\n";
+    else
+        cout << "Workload:  " << config.spec->name << " (" << config.spec->describe() << ")\n";
+    if (!config.replay)
+        cout << "Keys:      " << config.keys->describe() << " over " << config.keys->size() << " keys\n";
+    cout << "Timeout:   " << config.timeout_ms << " ms\n";
+    if (config.connections > 0)
+        cout << "Protocol:  http (epoll, " << config.connections << " keep-alive connections)\n";
+    else
+        cout << "Protocol:  " << (config.binary ? "binary (port " + to_string(config.binary_port) + ")" : string(config.keep_alive ? "http (keep-alive)" : "http (connection per request)")) << "\n";
+    if (config.replay)
+    {
+        cout << "Replay:    " << config.replay_file << ", " << config.replay->size() << " requests over "
+             << fixed << setprecision(1) << config.replay->span_s() << " s (x" << config.replay_speed << ")\n";
+        cout << "           " << config.replay->summary() << "\n";
+        if (config.replay->get_skipped())
+            cout << "           " << config.replay->get_skipped() << " not replayable (status, streamed bodies, bulk loads), skipped\n";
+        if (config.replay->get_clipped())
+            cout << "           " << config.replay->get_clipped() << " clipped to fit the request line\n";
+    }
+    if (config.sweep)
+        cout << "Load:      open-loop sweep from " << config.rate << " req/s (x" << config.sweep_factor << " per step)\n";
+    else if (config.rate > 0)
+        cout << "Load:      open loop, " << config.rate << " req/s (" << config.arrival << " arrivals)\n";
+    if (config.pipeline > 1)
+        cout << "Pipeline:  " << config.pipeline << " requests per batch\n";
+    if (config.preload)
+        cout << "Preload:   " << config.keys->size() << " records before the run\n";
+    cout << "========================================\n\n";
 
-    // Calculate percentiles
-    vector<double> response_times = metrics.response_times;
-    double p50 = calculate_percentile(response_times, 50);
-    double p95 = calculate_percentile(response_times, 95);
-    double p99 = calculate_percentile(response_times, 99);
+    if (config.preload)
+        preload(config);
+
+    if (config.sweep)
+        return run_sweep(config);
+
+    RunResult r = run_load(config, true);
 
     // Print results
     cout << "\n========================================\n";
     cout << "  Load Test Results\n";
     cout << "========================================\n";
-    cout << "Actual Duration:       " << fixed << setprecision(2) << actual_duration << " seconds\n";
-    cout << "Total Requests:        " << total_req << "\n";
-    cout << "Successful Requests:   " << success_req << "\n";
-    cout << "Failed Requests:       " << failed_req << "\n";
-    cout << "Success Rate:          " << fixed << setprecision(2) << success_rate << "%\n";
+    cout << "Actual Duration:       " << fixed << setprecision(2) << r.duration << " seconds\n";
+    cout << "Total Requests:        " << r.total << "\n";
+    cout << "Successful Requests:   " << r.success << "\n";
+    cout << "Failed Requests:       " << r.failed << "\n";
+    cout << "Success Rate:          " << fixed << setprecision(2) << r.success_rate << "%\n";
     cout << "\n";
-    cout << "Average Throughput:    " << fixed << setprecision(2) << throughput << " req/s\n";
-    cout << "Average Response Time: " << fixed << setprecision(2) << avg_response_time << " ms\n";
+    if (config.rate > 0)
+        cout << "Target Throughput:     " << fixed << setprecision(2) << config.rate << " req/s (open loop, " << config.arrival << ")\n";
+    cout << "Average Throughput:    " << fixed << setprecision(2) << r.throughput << " req/s\n";
+    cout << "Average Response Time: " << fixed << setprecision(3) << r.avg_ms << " ms\n";
     cout << "\n";
     cout << "Response Time Percentiles:\n";
-    cout << "  P50 (median):        " << fixed << setprecision(2) << p50 << " ms\n";
-    cout << "  P95:                 " << fixed << setprecision(2) << p95 << " ms\n";
-    cout << "  P99:                 " << fixed << setprecision(2) << p99 << " ms\n";
+    cout << "  P50 (median):        " << fixed << setprecision(3) << r.p50 << " ms\n";
+    cout << "  P90:                 " << fixed << setprecision(3) << r.p90 << " ms\n";
+    cout << "  P95:                 " << fixed << setprecision(3) << r.p95 << " ms\n";
+    cout << "  P99:                 " << fixed << setprecision(3) << r.p99 << " ms\n";
+    cout << "  P99.9:               " << fixed << setprecision(3) << r.p999 << " ms\n";
+    cout << "  P99.99:              " << fixed << setprecision(3) << r.p9999 << " ms\n";
+    cout << "  Max:                 " << fixed << setprecision(3) << r.max << " ms\n";
+    cout << "\n";
+    cout << "Per Route (successful latency, ms):\n";
+    cout << "  " << left << setw(12) << "route" << right << setw(10) << "ok" << setw(8) << "failed"
+         << setw(9) << "avg" << setw(9) << "p50" << setw(9) << "p99" << setw(9) << "p99.9" << setw(10) << "max" << "\n";
+    for (auto &rr : r.routes)
+    {
+        cout << "  " << left << setw(12) << Trace::name(rr.route) << right << setw(10) << rr.ok << setw(8) << rr.failed
+             << setprecision(3) << setw(9) << rr.avg_ms << setw(9) << rr.p50 << setw(9) << rr.p99
+             << setw(9) << rr.p999 << setw(10) << rr.max << "\n";
+    }
+    cout << "Status Codes:          ";
+    for (size_t i = 0; i < r.statuses.size(); i++)
+    {
+        cout << (i ? ", " : "") << (r.statuses[i].first ? to_string(r.statuses[i].first) : string("no response"))
+             << " x" << r.statuses[i].second;
+    }
+    cout << "\n";
+    cout << "Response Sources:      ";
+    for (int src = 0; src < SOURCES; src++)
+        cout << (src ? ", " : "") << source_name(src) << " " << r.sources[src];
+    cout << "\n";
     cout << "========================================\n";
 
+    if (!config.csv_file.empty())
+    {
+        if (write_csv(config.csv_file, r))
+            cout << "Time series written to " << config.csv_file << "\n";
+        else
+            cerr << "Cannot write " << config.csv_file << "\n";
+    }
+    if (!config.json_file.empty())
+    {
+        if (write_json(config.json_file, config, r))
+            cout << "Results written to " << config.json_file << "\n";
+        else
+            cerr << "Cannot write " << config.json_file << "\n";
+    }
+
     return 0;
 }
@@ -8,6 +8,7 @@ Usage: python3 parse_results.py <results_directory>
 import sys
 import os
 import re
+import json
 from pathlib import Path
 
 def parse_log_file(filepath):
@@ -26,6 +27,26 @@ def parse_log_file(filepath):
         'p99': None
     }
     
+    # the load generator's --json file, when the run wrote one, has the
+    # exact numbers; the log is the fallback
+    json_path = Path(filepath).with_suffix('.json')
+    if json_path.exists():
+        with open(json_path) as f:
+            data = json.load(f)
+        match = re.search(r'test_(\d+)threads', str(filepath))
+        metrics['threads'] = int(match.group(1)) if match else None
+        metrics['duration'] = data['duration_s']
+        metrics['total_requests'] = data['total']
+        metrics['successful_requests'] = data['success']
+        metrics['failed_requests'] = data['failed']
+        metrics['success_rate'] = data['success'] / data['total'] * 100 if data['total'] else 0.0
+        metrics['throughput'] = data['throughput']
+        metrics['avg_response_time'] = data['latency_ms']['avg']
+        metrics['p50'] = data['latency_ms']['p50']
+        metrics['p95'] = data['latency_ms']['p95']
+        metrics['p99'] = data['latency_ms']['p99']
+        return metrics
+
     with open(filepath, 'r') as f:
         content = f.read()
         
@@ -11,6 +11,11 @@ DURATION=60  # 5 minutes per test
 # Load levels to test
 LOAD_LEVELS=(1 5 10 20 40)
 
+# EPOLL_THREADS=N runs each load level as that many keep-alive connections
+# multiplexed over N event threads (--connections), so levels can go far
+# beyond one OS thread per client on the 3 pinned cores
+EPOLL_THREADS=${EPOLL_THREADS:-0}
+
 echo "=========================================="
 echo "Running Load Test Experiments"
 echo "=========================================="
@@ -18,6 +23,9 @@ echo "Workload:    $WORKLOAD"
 echo "Server:      $SERVER_HOST:$SERVER_PORT"
 echo "Duration:    $DURATION seconds per test"
 echo "Load levels: ${LOAD_LEVELS[@]}"
+if [ "$EPOLL_THREADS" -gt 0 ]; then
+    echo "Engine:      epoll, $EPOLL_THREADS threads (levels are connections)"
+fi
 echo "=========================================="
 echo ""
 
@@ -52,6 +60,7 @@ for THREADS in "${LOAD_LEVELS[@]}"; do
     echo "=========================================="
     
     OUTPUT_FILE="$RESULTS_DIR/test_${THREADS}threads.log"
+    JSON_FILE="$RESULTS_DIR/test_${THREADS}threads.json"
     RESOURCE_FILE="$RESULTS_DIR/resources_${THREADS}threads.csv"
     
     # Start resource monitoring in background
@@ -62,8 +71,12 @@ for THREADS in "${LOAD_LEVELS[@]}"; do
     sleep 2  # Give monitor time to start
     
     # Run load generator and save output
+    CLIENT_ARGS="-t $THREADS"
+    if [ "$EPOLL_THREADS" -gt 0 ]; then
+        CLIENT_ARGS="-t $(( THREADS < EPOLL_THREADS ? THREADS : EPOLL_THREADS )) --connections $THREADS"
+    fi
     taskset -c 9-11 ./load-generator -h "$SERVER_HOST" -p "$SERVER_PORT" \
-        -t "$THREADS" -d "$DURATION" -w "$WORKLOAD" | tee "$OUTPUT_FILE"
+        $CLIENT_ARGS -d "$DURATION" -w "$WORKLOAD" --json "$JSON_FILE" | tee "$OUTPUT_FILE"
     
     # Stop resource monitoring
     echo ""
@@ -72,7 +85,7 @@ for THREADS in "${LOAD_LEVELS[@]}"; do
     wait $MONITOR_PID 2>/dev/null
     
     echo ""
-    echo "Results saved to: $OUTPUT_FILE"
+    echo "Results saved to: $OUTPUT_FILE (per route and per second: $JSON_FILE)"
     echo "Resources saved to: $RESOURCE_FILE"
     echo ""
     
@@ -0,0 +1,109 @@
+#!/bin/bash
+
+# Tuning sweep: restart the server with different runtime settings and
+# record the throughput curve for each combination
+# Usage: ./run_tuning_sweep.sh <workload_type> [clients] [duration]
+#
+# Override the swept values with env vars, e.g.
+#   IO_THREADS_LIST="8 16 32" DB_POOL_LIST="5 10" CACHE_SIZE_LIST="1000" ./run_tuning_sweep.sh get_popular
+
+WORKLOAD=${1:-"mixed"}
+CLIENTS=${2:-20}
+DURATION=${3:-30}
+SERVER_HOST="127.0.0.1"
+SERVER_PORT=${SERVER_PORT:-8080}
+SERVER_BIN=${SERVER_BIN:-"../build/kv-server"}
+SERVER_CONFIG=${SERVER_CONFIG:-"../kvstore.conf"}
+
+# Values to sweep
+IO_THREADS_LIST=(${IO_THREADS_LIST:-8 16 32 64})
+DB_POOL_LIST=(${DB_POOL_LIST:-5 10 20})
+CACHE_SIZE_LIST=(${CACHE_SIZE_LIST:-1000 10000})
+
+echo "=========================================="
+echo "Running Tuning Sweep"
+echo "=========================================="
+echo "Workload:    $WORKLOAD"
+echo "Clients:     $CLIENTS"
+echo "Duration:    $DURATION seconds per run"
+echo "IO threads:  ${IO_THREADS_LIST[@]}"
+echo "DB pool:     ${DB_POOL_LIST[@]}"
+echo "Cache size:  ${CACHE_SIZE_LIST[@]}"
+echo "=========================================="
+echo ""
+
+if [ ! -x "$SERVER_BIN" ]; then
+    echo "Error: Server binary not found at $SERVER_BIN"
+    exit 1
+fi
+
+if pgrep -f kv-server > /dev/null; then
+    echo "Error: kv-server is already running. The sweep starts its own server, please stop it first."
+    exit 1
+fi
+
+CONFIG_ARGS=()
+if [ -f "$SERVER_CONFIG" ]; then
+    CONFIG_ARGS=(--config "$SERVER_CONFIG")
+fi
+
+RESULTS_DIR="results_tuning_${WORKLOAD}_$(date +%Y%m%d_%H%M%S)"
+mkdir -p "$RESULTS_DIR"
+SUMMARY="$RESULTS_DIR/tuning.csv"
+echo "io_threads,db_pool,cache_size,throughput,avg_ms,p50_ms,p95_ms,p99_ms,success_rate" > "$SUMMARY"
+
+echo "Results will be saved to: $RESULTS_DIR"
+echo ""
+
+for IO_THREADS in "${IO_THREADS_LIST[@]}"; do
+for DB_POOL in "${DB_POOL_LIST[@]}"; do
+for CACHE_SIZE in "${CACHE_SIZE_LIST[@]}"; do
+    NAME="io${IO_THREADS}_db${DB_POOL}_cache${CACHE_SIZE}"
+    echo "=========================================="
+    echo "Running: $NAME"
+    echo "=========================================="
+
+    # Start server with this combination, on cores 3-8 so it never shares
+    # one with the load generator on 9-11
+    taskset -c 3-8 "$SERVER_BIN" "${CONFIG_ARGS[@]}" --port "$SERVER_PORT" \
+        --io-threads "$IO_THREADS" --db-pool "$DB_POOL" --cache-size "$CACHE_SIZE" \
+        > "$RESULTS_DIR/server_${NAME}.log" 2>&1 &
+    SERVER_PID=$!
+
+    # Wait for it to come up
+    for i in $(seq 1 30); do
+        curl -s "http://$SERVER_HOST:$SERVER_PORT/status" > /dev/null 2>&1 && break
+        sleep 0.5
+    done
+
+    OUTPUT_FILE="$RESULTS_DIR/test_${NAME}.log"
+    taskset -c 9-11 ./load-generator -h "$SERVER_HOST" -p "$SERVER_PORT" \
+        -t "$CLIENTS" -d "$DURATION" -w "$WORKLOAD" > "$OUTPUT_FILE"
+
+    kill -INT $SERVER_PID 2>/dev/null
+    wait $SERVER_PID 2>/dev/null
+
+    # Pull the numbers out of the load generator report
+    THROUGHPUT=$(grep "Average Throughput" "$OUTPUT_FILE" | awk '{print $3}')
+    AVG=$(grep "Average Response Time" "$OUTPUT_FILE" | awk '{print $4}')
+    P50=$(grep "P50" "$OUTPUT_FILE" | awk '{print $3}')
+    P95=$(grep "P95:" "$OUTPUT_FILE" | awk '{print $2}')
+    P99=$(grep "P99:" "$OUTPUT_FILE" | awk '{print $2}')
+    SUCCESS=$(grep "Success Rate" "$OUTPUT_FILE" | awk '{print $3}' | tr -d '%')
+
+    echo "$IO_THREADS,$DB_POOL,$CACHE_SIZE,$THROUGHPUT,$AVG,$P50,$P95,$P99,$SUCCESS" >> "$SUMMARY"
+    echo "  Throughput: $THROUGHPUT req/s, P99: $P99 ms"
+    echo ""
+
+    sleep 5
+done
+done
+done
+
+echo "=========================================="
+echo "Tuning sweep completed!"
+echo "=========================================="
+echo "Throughput curve: $SUMMARY"
+echo ""
+echo "Top configurations by throughput:"
+(head -1 "$SUMMARY"; tail -n +2 "$SUMMARY" | sort -t, -k4 -n -r | head -3) | column -t -s,
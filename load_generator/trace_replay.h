@@ -0,0 +1,200 @@
+// Trace replay for the load generator
+// Turns a server request trace (trace_file option) back into HTTP requests
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "../server/trace.h"
+
+using namespace std;
+
+// The trace only has key hashes, so key_<hash> stands in for each original
+// key and texts are regenerated from their hash: the same key or text in the
+// trace is the same key or text in the replay, which is what caches see.
+// Values and texts travel in the query string and are capped to fit the
+// server's 8 KB request line; oversized records are counted as clipped.
+class TraceReplay
+{
+private:
+    static constexpr size_t MAX_QUERY = 7000;
+
+    Trace::Header header;
+    vector<Trace::Record> records; // replayable ones, in arrival order
+    size_t skipped = 0;            // routes that can't be replayed (status, streamed bodies)
+    size_t clipped = 0;
+    double speed = 1.0;
+
+    static uint64_t splitmix(uint64_t &x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // the same seed always gives the same text
+    static string text(uint64_t seed, size_t len)
+    {
+        static const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+        string out(len, ' ');
+        uint64_t r = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            if (i % 8 == 0)
+                r = splitmix(seed);
+            out[i] = charset[(r & 0xFF) % 62];
+            r >>= 8;
+        }
+        return out;
+    }
+
+    static string key(uint64_t h) { return "key_" + to_string(h); }
+
+    static bool replayable(uint8_t route)
+    {
+        return route != Trace::OTHER && route != Trace::STATUS &&
+               route != Trace::HASH_STREAM && route != Trace::KV_BULK_LOAD && route < Trace::ROUTES;
+    }
+
+public:
+    bool load(const string &path, double replay_speed, string &err)
+    {
+        vector<Trace::Record> all;
+        if (!Trace::load(path, header, all, err))
+            return false;
+        speed = replay_speed;
+        for (auto &r : all)
+        {
+            if (!replayable(r.route))
+            {
+                skipped++;
+                continue;
+            }
+            records.push_back(r);
+            bool big = (r.route == Trace::KV_CREATE || r.route == Trace::HASH) && r.size > MAX_QUERY;
+            big = big || (r.route == Trace::KV_MGET && (size_t)r.size * 26 > MAX_QUERY);
+            big = big || (r.route == Trace::KV_MPUT && (size_t)r.size * (r.extra + 40) > MAX_QUERY);
+            if (big)
+                clipped++;
+        }
+        if (records.empty())
+        {
+            err = path + " has no replayable requests";
+            return false;
+        }
+        return true;
+    }
+
+    size_t size() const { return records.size(); }
+    size_t get_skipped() const { return skipped; }
+    size_t get_clipped() const { return clipped; }
+
+    // replay length in seconds at the chosen speed
+    double span_s() const
+    {
+        return (records.back().t_us - records.front().t_us) / speed / 1e6;
+    }
+
+    // send time of record i, relative to the start of the replay
+    int64_t offset_us(size_t i) const
+    {
+        return (int64_t)((records[i].t_us - records.front().t_us) / speed);
+    }
+
+    // requests per route, e.g. "kv_read 812, kv_create 97"
+    string summary() const
+    {
+        vector<size_t> counts(Trace::ROUTES);
+        for (auto &r : records)
+            counts[r.route]++;
+        string out;
+        for (int i = 0; i < Trace::ROUTES; i++)
+        {
+            if (!counts[i])
+                continue;
+            if (!out.empty())
+                out += ", ";
+            out += string(Trace::name(i)) + " " + to_string(counts[i]);
+        }
+        return out;
+    }
+
+    // HTTP request for record i
+    void request(size_t i, string &method, string &path, string &params) const
+    {
+        const Trace::Record &r = records[i];
+        method = "GET";
+        params.clear();
+        switch (r.route)
+        {
+        case Trace::KV_CREATE:
+            method = "POST";
+            path = "/kv/create";
+            params = "key=" + key(r.key) + "&value=" + text(r.key ^ r.size, min<size_t>(r.size, MAX_QUERY));
+            break;
+        case Trace::KV_READ:
+            path = "/kv/read";
+            params = "key=" + key(r.key);
+            break;
+        case Trace::KV_DELETE:
+            method = "DELETE";
+            path = "/kv/delete";
+            params = "key=" + key(r.key);
+            break;
+        case Trace::KV_MGET:
+        {
+            path = "/kv/mget";
+            params = "keys=";
+            size_t n = max<size_t>(1, min<size_t>(r.size, MAX_QUERY / 26));
+            for (size_t k = 0; k < n; k++)
+                params += (k ? "," : "") + key(r.key + k);
+            break;
+        }
+        case Trace::KV_MPUT:
+        {
+            method = "POST";
+            path = "/kv/mput";
+            size_t n = max<size_t>(1, min<size_t>(r.size, MAX_QUERY / (r.extra + 40)));
+            size_t len = min<size_t>(r.extra, MAX_QUERY);
+            for (size_t k = 0; k < n; k++)
+                params += (k ? "&key=" : "key=") + key(r.key + k) + "&value=" + text(r.key + k, len);
+            break;
+        }
+        case Trace::KV_SCAN:
+            path = "/kv/scan";
+            params = "prefix=key_&limit=" + to_string(max<uint32_t>(r.size, 1));
+            break;
+        case Trace::PRIME:
+            path = "/compute/prime";
+            params = "count=" + to_string(r.size);
+            break;
+        case Trace::IS_PRIME:
+            path = "/compute/is_prime";
+            params = "n=" + to_string(r.key);
+            break;
+        case Trace::PRIMES:
+            path = "/compute/primes";
+            params = "from=" + to_string(r.key) + "&to=" + to_string(r.key + r.size);
+            break;
+        case Trace::NTH_PRIME:
+            path = "/compute/nth_prime";
+            params = "n=" + to_string(r.key);
+            break;
+        case Trace::HASH:
+        {
+            static const char *algos[] = {"poly31", "xxh3", "wyhash"};
+            path = "/compute/hash";
+            params = "text=" + text(r.key, min<size_t>(r.size, MAX_QUERY));
+            if (r.extra > 0 && r.extra < 3)
+                params += "&algo=" + string(algos[r.extra]);
+            break;
+        }
+        }
+    }
+};
+
+#endif
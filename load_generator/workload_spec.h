@@ -0,0 +1,319 @@
+// Declarative workloads for the load generator
+// YCSB-style property files compiled at startup into an op table
+
+#ifndef WORKLOAD_SPEC_H
+#define WORKLOAD_SPEC_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// A workload is a set of properties, one per line, # starts a comment:
+//
+//   readproportion = 0.5             operation mix, normalised to sum to 1
+//   updateproportion = 0.5
+//   requestdistribution = zipfian    uniform, zipfian, scrambled, latest, hotspot
+//   recordcount = 100000             key space (--keys)
+//   fieldlength = 1000               value bytes (x fieldcount)
+//   fieldlengthdistribution = constant
+//   phase = run                      or load: insert recordcount keys, then stop
+//
+// Real YCSB workload files load as they are; the YCSB properties without a
+// counterpart here (operationcount, readallfields, ...) are accepted and
+// ignored. Key settings given on the command line win over the file's.
+// Built-in: the original -w workloads and ycsb_a .. ycsb_f.
+struct WorkloadSpec
+{
+    enum OpType
+    {
+        READ,              // GET /kv/read, key from the distribution
+        READ_POPULAR,      // GET /kv/read, popular_key_N
+        UPDATE,            // POST /kv/create, existing key from the distribution
+        INSERT,            // POST /kv/create, new key (latest) or drawn like update
+        DELETE,            // DELETE /kv/delete
+        SCAN,              // GET /kv/scan from a key
+        READ_MODIFY_WRITE, // read, then the next request updates the same key
+        PRIME,             // GET /compute/prime
+        HASH,              // GET /compute/hash
+        OP_TYPES
+    };
+
+    struct Op
+    {
+        OpType type;
+        double upto; // cumulative probability, the op runs when u < upto
+    };
+
+    string name;
+    double proportion[OP_TYPES] = {};
+    vector<Op> ops; // compiled by compile(), most likely first
+
+    // keys, empty / 0 leaves the command-line setting
+    string request_distribution;
+    long record_count = 0;
+    double zipf_theta = 0;
+    double hot_keys = 0, hot_ops = 0;
+    int popular_keys = 0;
+
+    // values: fieldcount x a length from the distribution
+    string value_distribution = "constant"; // constant, uniform, zipfian
+    int value_min = 1, value_max = 50, field_count = 1;
+
+    // scans
+    string scan_distribution = "uniform"; // uniform, zipfian
+    int scan_max = 100;
+
+    // compute routes
+    int prime_min = 100, prime_max = 1000;
+    int hash_length = 100;
+
+    bool load_phase = false;
+
+    static const char *op_name(int t)
+    {
+        static const char *names[] = {"read", "read_popular", "update", "insert", "delete",
+                                      "scan", "read_modify_write", "prime", "hash"};
+        return names[t];
+    }
+
+    // "read 50%, update 50%"
+    string describe() const
+    {
+        ostringstream out;
+        double prev = 0;
+        for (auto &op : ops)
+        {
+            if (prev > 0)
+                out << ", ";
+            out << op_name(op.type) << " " << round((op.upto - prev) * 1000) / 10 << "%";
+            prev = op.upto;
+        }
+        return out.str();
+    }
+
+    // only read, create and delete requests (binary protocol, pipelining)
+    bool kv_basic() const
+    {
+        for (auto &op : ops)
+        {
+            if (op.type == SCAN || op.type == PRIME || op.type == HASH)
+                return false;
+        }
+        return true;
+    }
+
+    bool set(const string &key, const string &value, string &err)
+    {
+        static const char *proportions[] = {"readproportion", "popularreadproportion", "updateproportion",
+                                            "insertproportion", "deleteproportion", "scanproportion",
+                                            "readmodifywriteproportion", "primeproportion", "hashproportion"};
+        static const char *ignored[] = {"workload", "operationcount", "readallfields", "writeallfields",
+                                        "insertorder", "insertstart", "insertcount", "table",
+                                        "dataintegrity", "minscanlength", "maxexecutiontime"};
+        char *end;
+        double num = strtod(value.c_str(), &end);
+        bool is_num = !value.empty() && *end == '\0';
+
+        for (int t = 0; t < OP_TYPES; t++)
+        {
+            if (key != proportions[t])
+                continue;
+            if (!is_num || num < 0)
+            {
+                err = key + " must be a non-negative number";
+                return false;
+            }
+            proportion[t] = num;
+            return true;
+        }
+        for (auto k : ignored)
+        {
+            if (key == k)
+                return true;
+        }
+
+        if (key == "name")
+            name = value;
+        else if (key == "requestdistribution")
+            request_distribution = value;
+        else if (key == "fieldlengthdistribution")
+            value_distribution = value;
+        else if (key == "scanlengthdistribution")
+            scan_distribution = value;
+        else if (key == "phase" && (value == "load" || value == "run"))
+            load_phase = value == "load";
+        else if (!is_num)
+        {
+            err = "bad value for " + key + ": '" + value + "'";
+            return false;
+        }
+        else if (key == "recordcount")
+            record_count = (long)num;
+        else if (key == "zipfianconstant")
+            zipf_theta = num;
+        else if (key == "hotspotdatafraction")
+            hot_keys = num;
+        else if (key == "hotspotopnfraction")
+            hot_ops = num;
+        else if (key == "popularkeys")
+            popular_keys = (int)num;
+        else if (key == "fieldlength")
+            value_max = (int)num;
+        else if (key == "minfieldlength")
+            value_min = (int)num;
+        else if (key == "fieldcount")
+            field_count = (int)num;
+        else if (key == "maxscanlength")
+            scan_max = (int)num;
+        else if (key == "primemin")
+            prime_min = (int)num;
+        else if (key == "primemax")
+            prime_max = (int)num;
+        else if (key == "hashlength")
+            hash_length = (int)num;
+        else
+        {
+            err = "unknown property '" + key + "'";
+            return false;
+        }
+        return true;
+    }
+
+    // key = value lines; where names the source in errors
+    bool parse(const string &text, const string &where, string &err)
+    {
+        istringstream in(text);
+        string line;
+        int line_no = 0;
+        while (getline(in, line))
+        {
+            line_no++;
+            line = line.substr(0, line.find('#'));
+            size_t eq = line.find('=');
+            auto trim = [](const string &s)
+            {
+                size_t b = s.find_first_not_of(" \t\r");
+                return b == string::npos ? string() : s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+            };
+            if (trim(line).empty())
+                continue;
+            if (eq == string::npos)
+            {
+                err = where + ":" + to_string(line_no) + ": expected key = value";
+                return false;
+            }
+            if (!set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), err))
+            {
+                err = where + ":" + to_string(line_no) + ": " + err;
+                return false;
+            }
+        }
+        return compile(err);
+    }
+
+    // op table from the proportions, checks the rest
+    bool compile(string &err)
+    {
+        double total = 0;
+        for (double p : proportion)
+            total += p;
+        if (total <= 0)
+        {
+            err = "workload has no operations (all proportions are 0)";
+            return false;
+        }
+        if (value_min < 0 || value_max < value_min || field_count < 1 || scan_max < 1 ||
+            prime_min < 1 || prime_max < prime_min || hash_length < 0)
+        {
+            err = "bad field, scan, prime or hash length settings";
+            return false;
+        }
+        // values and texts travel in the query string, the server takes 8 KB request lines
+        if ((long)value_max * field_count > 7000 || hash_length > 7000)
+        {
+            err = "fieldcount x fieldlength and hashlength must stay under 7000 bytes";
+            return false;
+        }
+        if ((value_distribution != "constant" && value_distribution != "uniform" && value_distribution != "zipfian") ||
+            (scan_distribution != "uniform" && scan_distribution != "zipfian"))
+        {
+            err = "fieldlengthdistribution must be constant, uniform or zipfian, scanlengthdistribution uniform or zipfian";
+            return false;
+        }
+
+        // most likely ops first, so the scan over the table usually stops at once
+        vector<int> order;
+        for (int t = 0; t < OP_TYPES; t++)
+        {
+            if (proportion[t] > 0)
+                order.push_back(t);
+        }
+        stable_sort(order.begin(), order.end(), [this](int a, int b)
+                    { return proportion[a] > proportion[b]; });
+        ops.clear();
+        double upto = 0;
+        for (int t : order)
+        {
+            upto += proportion[t] / total;
+            ops.push_back({(OpType)t, upto});
+        }
+        ops.back().upto = 1.0;
+        return true;
+    }
+
+    static const vector<pair<string, string>> &builtins()
+    {
+        // the YCSB core workloads use 1 KB records (10 fields x 100 bytes)
+        static const string ycsb = "requestdistribution = zipfian\nfieldlength = 1000\n";
+        static const vector<pair<string, string>> list = {
+            {"get_all", "readproportion = 1"},
+            {"put_all", "insertproportion = 0.9\ndeleteproportion = 0.1"},
+            {"get_popular", "popularreadproportion = 1\npopularkeys = 10"},
+            {"mixed", "readproportion = 0.49\npopularreadproportion = 0.21\npopularkeys = 20\n"
+                      "insertproportion = 0.2\ndeleteproportion = 0.1"},
+            {"compute_prime", "primeproportion = 1"},
+            {"compute_hash", "hashproportion = 1"},
+            {"compute_mixed", "hashproportion = 0.6\nprimeproportion = 0.4"},
+            {"ycsb_a", ycsb + "readproportion = 0.5\nupdateproportion = 0.5"},
+            {"ycsb_b", ycsb + "readproportion = 0.95\nupdateproportion = 0.05"},
+            {"ycsb_c", ycsb + "readproportion = 1"},
+            {"ycsb_d", "requestdistribution = latest\nfieldlength = 1000\nreadproportion = 0.95\ninsertproportion = 0.05"},
+            {"ycsb_e", ycsb + "scanproportion = 0.95\ninsertproportion = 0.05\nmaxscanlength = 100"},
+            {"ycsb_f", ycsb + "readproportion = 0.5\nreadmodifywriteproportion = 0.5"},
+        };
+        return list;
+    }
+
+    // a built-in name or a spec file
+    static bool load(const string &name_or_path, WorkloadSpec &out, string &err)
+    {
+        out = WorkloadSpec();
+        for (auto &b : builtins())
+        {
+            if (b.first == name_or_path)
+            {
+                out.name = b.first;
+                return out.parse(b.second, b.first, err);
+            }
+        }
+
+        ifstream in(name_or_path);
+        if (!in)
+        {
+            err = "Invalid workload type: " + name_or_path + " (not a built-in workload or a readable spec file)";
+            return false;
+        }
+        stringstream text;
+        text << in.rdbuf();
+        out.name = name_or_path;
+        return out.parse(text.str(), name_or_path, err);
+    }
+};
+
+#endif
@@ -4,26 +4,53 @@
 #include <iostream>
 #include <csignal>
 #include "include/config.h"
+#include "include/config_loader.h"
 #include "cache/cache.h"
+#include "cache/hash_cache.h"
 #include "db/db.h"
 #include "server/server.h"
 
 using namespace std;
 
 Server *global_srv = nullptr;
+BinaryServer *global_bin = nullptr;
+PipelineServer *global_pipe = nullptr;
+TraceRecorder *global_trace = nullptr;
 
 void handle_signal(int sig)
 {
     cout << "\nShutting down...\n";
+    if (global_bin)
+    {
+        global_bin->stop();
+    }
+    if (global_pipe)
+    {
+        global_pipe->stop();
+    }
     if (global_srv)
     {
         global_srv->stop();
     }
+    if (global_trace)
+    {
+        // flush buffered records, exit() skips destructors
+        global_trace->stop();
+        cout << "Trace: " << global_trace->get_written() << " requests written, "
+             << global_trace->get_dropped() << " dropped\n";
+    }
     exit(0);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    // config file, env and flags override the defaults in config.h
+    if (!Config::load(argc, argv))
+    {
+        Config::print_usage(argv[0]);
+        return 1;
+    }
+
     cout << "=================================\n";
     cout << "  KV Store Server\n";
     cout << "=================================\n\n";
@@ -36,7 +63,7 @@ int main()
     cout << "KV Cache created (size=" << Config::CACHE_SIZE << ")\n";
 
     // create Hash cache
-    Cache hash_cache(Config::HASH_CACHE_SIZE);
+    HashCache hash_cache(Config::HASH_CACHE_SIZE);
     cout << "Hash Cache created (size=" << Config::HASH_CACHE_SIZE << ")\n";
 
     // create db pool
@@ -46,6 +73,62 @@ int main()
     Server srv(&cache, &hash_cache, &db);
     global_srv = &srv;
 
+    // binary protocol listener sharing the same cache and db
+    BinaryServer bin(&cache, &db, Config::BINARY_THREADS);
+    if (Config::BINARY_PORT > 0)
+    {
+        if (bin.start(Config::HOST, Config::BINARY_PORT))
+        {
+            global_bin = &bin;
+            srv.set_binary(&bin);
+            cout << "Binary protocol on " << Config::HOST << ":" << Config::BINARY_PORT << "\n";
+        }
+        else
+        {
+            cerr << "Failed to start binary listener on port " << Config::BINARY_PORT << "\n";
+        }
+    }
+
+    // pipelined HTTP/1.1 listener for the /kv routes
+    PipelineServer pipe(&cache, &db, Config::PIPELINE_THREADS);
+    if (Config::PIPELINE_PORT > 0)
+    {
+        if (pipe.start(Config::HOST, Config::PIPELINE_PORT))
+        {
+            global_pipe = &pipe;
+            srv.set_pipeline(&pipe);
+            cout << "Pipelined HTTP on " << Config::HOST << ":" << Config::PIPELINE_PORT << "\n";
+        }
+        else
+        {
+            cerr << "Failed to start pipelined listener on port " << Config::PIPELINE_PORT << "\n";
+        }
+    }
+
+    // request trace for replay by the load generator
+    TraceRecorder trace(Config::TRACE_BUFFER);
+    if (!Config::TRACE_FILE.empty())
+    {
+        if (trace.start_file(Config::TRACE_FILE))
+        {
+            global_trace = &trace;
+            srv.set_trace(&trace);
+            cout << "Tracing requests to " << Config::TRACE_FILE << "\n";
+        }
+        else
+        {
+            cerr << "Cannot open trace file " << Config::TRACE_FILE << "\n";
+        }
+    }
+
+    if (Config::PROFILE)
+    {
+        if (srv.set_profile(true, Config::PROFILE_ROUTE))
+            cout << "Profiling " << (Config::PROFILE_ROUTE.empty() ? "all routes" : Config::PROFILE_ROUTE) << "\n";
+        else
+            cerr << "Unknown profile_route " << Config::PROFILE_ROUTE << "\n";
+    }
+
     cout << "Ready to start on http://" << Config::HOST << ":" << Config::PORT << "\n";
     cout << "Press Ctrl+C to stop\n";
 
@@ -1,6 +1,7 @@
 #!/bin/bash
 
 # Script to start KV Server pinned to CPU cores 3-9
+# Extra arguments are passed to the server, e.g. ./run_server.sh --config kvstore.conf --io-threads 16
 
 echo "=========================================="
 echo "Starting KV Server (pinned to cores 3-9)"
@@ -37,4 +38,4 @@ echo "Starting server on cores 3-9..."
 echo "Server will run in foreground (press Ctrl+C to stop)"
 echo ""
 
-taskset -c 3-9 ./build/kv-server
+taskset -c 3-9 ./build/kv-server "$@"
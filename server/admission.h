@@ -0,0 +1,111 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// admission control for one executor
+// sheds when the queue is too deep, or CoDel-style when queue wait
+// has stayed above target for a whole interval
+class Admission
+{
+private:
+    using clock = chrono::steady_clock;
+
+    int queue_limit;
+    long target_us;
+    long interval_us;
+
+    mutex mtx;
+    clock::time_point first_above{}; // when wait first went over target
+    clock::time_point drop_next{};   // next shed while dropping
+    bool dropping = false;
+    int drop_count = 0;
+
+    atomic<long> admitted{0};
+    atomic<long> shed_queue{0};
+    atomic<long> shed_sojourn{0};
+
+    // CoDel control law: shed more often the longer we stay overloaded
+    clock::time_point next_drop(clock::time_point now)
+    {
+        long us = (long)(interval_us / sqrt((double)max(drop_count, 1)));
+        return now + chrono::microseconds(us);
+    }
+
+    bool should_drop(int queue_depth, long wait_us)
+    {
+        lock_guard<mutex> lock(mtx);
+        auto now = clock::now();
+
+        if (queue_depth == 0 || wait_us < target_us)
+        {
+            // queue empty or drained below target, leave dropping state
+            first_above = clock::time_point{};
+            dropping = false;
+            return false;
+        }
+
+        if (!dropping)
+        {
+            if (first_above == clock::time_point{})
+            {
+                first_above = now + chrono::microseconds(interval_us);
+                return false;
+            }
+            if (now < first_above)
+                return false;
+
+            dropping = true;
+            drop_count = 1;
+            drop_next = next_drop(now);
+            return true;
+        }
+
+        if (now < drop_next)
+            return false;
+
+        drop_count++;
+        drop_next = next_drop(now);
+        return true;
+    }
+
+public:
+    Admission(int limit, int target_ms, int interval_ms)
+        : queue_limit(limit), target_us(target_ms * 1000L), interval_us(interval_ms * 1000L) {}
+
+    // decide whether to run a request, given the pool's current queue depth
+    // and the queue wait of the job it last dequeued
+    bool admit(int queue_depth, long wait_us)
+    {
+        if (queue_limit > 0 && queue_depth >= queue_limit)
+        {
+            shed_queue++;
+            return false;
+        }
+        if (should_drop(queue_depth, wait_us))
+        {
+            shed_sojourn++;
+            return false;
+        }
+        admitted++;
+        return true;
+    }
+
+    // get stats
+    long get_admitted() { return admitted; }
+    long get_shed_queue() { return shed_queue; }
+    long get_shed_sojourn() { return shed_sojourn; }
+    bool is_dropping()
+    {
+        lock_guard<mutex> lock(mtx);
+        return dropping;
+    }
+};
+
+#endif
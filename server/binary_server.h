@@ -0,0 +1,255 @@
+#ifndef BINARY_SERVER_H
+#define BINARY_SERVER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <arpa/inet.h>
+#include "../include/config.h"
+#include "tcp_listener.h"
+#include "kv_ops.h"
+
+using namespace std;
+
+// compact binary kv protocol, shares the cache and db with the http server
+//
+// every frame is [u32 len][u8 op or status][payload], len counts op + payload,
+// integers are big-endian. Clients may pipeline: all complete frames in a read
+// are answered in order with a single write.
+//
+//   GET   [u16 klen][key]                    -> OK [u32 vlen][val] | NOT_FOUND
+//   SET   [u16 klen][key][u32 vlen][val]     -> OK | ERROR
+//   DEL   [u16 klen][key]                    -> OK
+//   MGET  [u16 n] n x [u16 klen][key]        -> OK [u16 n] n x [u8 found][u32 vlen][val]
+//
+// Keys over MAX_KEY, values over MAX_VALUE and MGETs over Config::MAX_BATCH
+// keys are answered with ERROR.
+namespace Binary
+{
+    enum Op : uint8_t
+    {
+        GET = 1,
+        SET = 2,
+        DEL = 3,
+        MGET = 4,
+    };
+
+    enum Status : uint8_t
+    {
+        OK = 0,
+        NOT_FOUND = 1,
+        ERROR = 2,
+    };
+
+    const uint32_t MAX_FRAME = 16 * 1024 * 1024;
+    const size_t MAX_KEY = 255;       // kv_pairs.kv_key VARCHAR(255)
+    const uint32_t MAX_VALUE = 65535; // kv_pairs.kv_value TEXT
+
+    inline void put_u16(string &out, uint16_t v)
+    {
+        v = htons(v);
+        out.append((const char *)&v, 2);
+    }
+
+    inline void put_u32(string &out, uint32_t v)
+    {
+        v = htonl(v);
+        out.append((const char *)&v, 4);
+    }
+
+    // bounds-checked reader over one frame payload
+    struct Reader
+    {
+        const char *p;
+        size_t left;
+
+        bool u16(uint16_t &v)
+        {
+            if (left < 2)
+                return false;
+            memcpy(&v, p, 2);
+            v = ntohs(v);
+            p += 2;
+            left -= 2;
+            return true;
+        }
+
+        bool u32(uint32_t &v)
+        {
+            if (left < 4)
+                return false;
+            memcpy(&v, p, 4);
+            v = ntohl(v);
+            p += 4;
+            left -= 4;
+            return true;
+        }
+
+        bool bytes(size_t n, string &s)
+        {
+            if (left < n)
+                return false;
+            s.assign(p, n);
+            p += n;
+            left -= n;
+            return true;
+        }
+
+        bool key(string &k)
+        {
+            uint16_t n;
+            return u16(n) && n <= MAX_KEY && bytes(n, k);
+        }
+    };
+}
+
+class BinaryServer : public TcpListener
+{
+private:
+    KVOps kv;
+    atomic<long> requests{0};
+
+    // append the response frame for one request frame
+    void handle(const char *frame, uint32_t len, string &out)
+    {
+        requests++;
+
+        uint8_t op = frame[0];
+        Binary::Reader in{frame + 1, len - 1};
+        string body;
+        uint8_t status = Binary::OK;
+        string key, val;
+
+        switch (op)
+        {
+        case Binary::GET:
+            if (!in.key(key))
+                status = Binary::ERROR;
+            else if (kv.read(key, val))
+            {
+                Binary::put_u32(body, val.size());
+                body += val;
+            }
+            else
+                status = Binary::NOT_FOUND;
+            break;
+
+        case Binary::SET:
+        {
+            uint32_t vlen;
+            if (!in.key(key) || key.empty() || !in.u32(vlen) || vlen > Binary::MAX_VALUE || !in.bytes(vlen, val))
+                status = Binary::ERROR;
+            else if (!kv.write(key, val))
+                status = Binary::ERROR;
+            break;
+        }
+
+        case Binary::DEL:
+            if (!in.key(key))
+                status = Binary::ERROR;
+            else
+                kv.remove(key);
+            break;
+
+        case Binary::MGET:
+        {
+            uint16_t n;
+            if (!in.u16(n) || n > Config::MAX_BATCH)
+            {
+                status = Binary::ERROR;
+                break;
+            }
+            vector<string> keys(n), vals;
+            vector<const char *> sources;
+            for (auto &k : keys)
+            {
+                if (!in.key(k))
+                {
+                    status = Binary::ERROR;
+                    break;
+                }
+            }
+            if (status != Binary::OK)
+                break;
+
+            kv.read_many(keys, vals, sources);
+            Binary::put_u16(body, n);
+            for (int i = 0; i < n; i++)
+            {
+                body += (char)(sources[i] ? 1 : 0);
+                Binary::put_u32(body, sources[i] ? vals[i].size() : 0);
+                if (sources[i])
+                    body += vals[i];
+            }
+            break;
+        }
+
+        default:
+            status = Binary::ERROR;
+        }
+
+        Binary::put_u32(out, body.size() + 1);
+        out += (char)status;
+        out += body;
+    }
+
+    // serve one connection until the client closes it, idles for
+    // idle_timeout or leaves a frame unfinished for read_timeout
+    void serve(int fd) override
+    {
+        string buf, out;
+        char chunk[16384];
+        auto deadline = clock::now() + idle_timeout;
+
+        for (;;)
+        {
+            ssize_t n = recv_by(fd, chunk, sizeof(chunk), deadline);
+            if (n <= 0)
+                break;
+            bool was_empty = buf.empty();
+            buf.append(chunk, n);
+
+            // answer every complete frame in the buffer, in order
+            size_t pos = 0;
+            bool bad = false;
+            while (buf.size() - pos >= 4)
+            {
+                uint32_t len;
+                memcpy(&len, buf.data() + pos, 4);
+                len = ntohl(len);
+                if (len == 0 || len > Binary::MAX_FRAME)
+                {
+                    bad = true;
+                    break;
+                }
+                if (buf.size() - pos - 4 < len)
+                    break;
+                handle(buf.data() + pos + 4, len, out);
+                pos += 4 + len;
+            }
+            buf.erase(0, pos);
+            deadline = next_deadline(!buf.empty(), was_empty || pos > 0, deadline);
+
+            if (!out.empty())
+            {
+                if (!send_all(fd, out))
+                    break;
+                out.clear();
+            }
+            if (bad)
+                break;
+        }
+    }
+
+public:
+    BinaryServer(Cache *c, DB *d, int threads) : TcpListener("binary", threads), kv(c, d) {}
+
+    ~BinaryServer() override { stop(); }
+
+    // get stats
+    long get_requests() { return requests; }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// decides which storage tiers a deterministic computation is worth
+//
+// compute cost is learned as ns per input byte, each tier's cost as the
+// time of one lookup. A tier is used only when computing the result would
+// take longer than looking it up there, so cheap results are computed
+// inline and never stored. A db miss also pays for writing the result back,
+// so the db is used only when lookup + miss rate x (compute + write) beats
+// computing every time. Skipped tiers are still probed every
+// `probe_every` requests so their costs keep tracking reality.
+class CostModel
+{
+public:
+    enum Tier
+    {
+        CACHE,
+        DB,
+        TIERS
+    };
+
+private:
+    // exponentially weighted moving average, 0 until the first sample
+    struct Ewma
+    {
+        atomic<double> value{0};
+        atomic<long> samples{0};
+
+        void add(double sample)
+        {
+            double v = value.load(memory_order_relaxed);
+            bool first = samples.fetch_add(1, memory_order_relaxed) == 0;
+            value.store(first ? sample : v * 0.9 + sample * 0.1, memory_order_relaxed);
+        }
+
+        double get() const { return value.load(memory_order_relaxed); }
+        bool empty() const { return samples.load(memory_order_relaxed) == 0; }
+    };
+
+    int probe_every;
+    atomic<long> requests{0};
+
+    Ewma compute_ns_per_byte;
+    Ewma compute_ns_fixed; // per-call overhead, from inputs under 64 bytes
+    Ewma tier_ns[TIERS];
+    Ewma db_write_ns;
+    Ewma db_miss_rate; // 1 per db miss, 0 per hit
+
+public:
+    using clock = chrono::steady_clock;
+
+    static double ns_since(clock::time_point start)
+    {
+        return chrono::duration<double, nano>(clock::now() - start).count();
+    }
+
+    CostModel(int probe) : probe_every(probe) {}
+
+    void record_compute(size_t bytes, double ns)
+    {
+        if (bytes < 64)
+            compute_ns_fixed.add(ns);
+        else
+            compute_ns_per_byte.add(ns / bytes);
+    }
+
+    void record_tier(Tier t, double ns) { tier_ns[t].add(ns); }
+    void record_db_write(double ns) { db_write_ns.add(ns); }
+    void record_db_lookup(bool hit) { db_miss_rate.add(hit ? 0 : 1); }
+
+    // expected cost of going through the db instead of computing: every
+    // request pays a lookup, a miss still computes and then writes back
+    double db_estimate(double compute) const
+    {
+        double miss = db_miss_rate.empty() ? 1 : db_miss_rate.get();
+        return tier_ns[DB].get() + miss * (compute + db_write_ns.get());
+    }
+
+    // expected time to compute the result for an input of `bytes`
+    double compute_estimate(size_t bytes) const
+    {
+        return compute_ns_fixed.get() + compute_ns_per_byte.get() * bytes;
+    }
+
+    // one decision per request: which tiers to look in (and fill)
+    void plan(size_t bytes, bool use[TIERS])
+    {
+        bool probe = probe_every > 0 && requests++ % probe_every == 0;
+        double compute = compute_estimate(bytes);
+        // unmeasured tiers are used until they have a cost
+        use[CACHE] = probe || tier_ns[CACHE].empty() || compute > tier_ns[CACHE].get();
+        use[DB] = probe || tier_ns[DB].empty() || db_write_ns.empty() || compute > db_estimate(compute);
+    }
+
+    // "cost_..." fields for /status
+    string stats_json() const
+    {
+        string json;
+        json += "\"cost_compute_ns_per_byte\": " + to_string(compute_ns_per_byte.get()) + ", ";
+        json += "\"cost_compute_ns_fixed\": " + to_string(compute_ns_fixed.get()) + ", ";
+        json += "\"cost_cache_lookup_ns\": " + to_string(tier_ns[CACHE].get()) + ", ";
+        json += "\"cost_db_lookup_ns\": " + to_string(tier_ns[DB].get()) + ", ";
+        json += "\"cost_db_write_ns\": " + to_string(db_write_ns.get()) + ", ";
+        json += "\"cost_db_miss_rate\": " + to_string(db_miss_rate.get());
+        return json;
+    }
+};
+
+#endif
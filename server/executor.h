@@ -0,0 +1,162 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include "../include/httplib.h"
+
+using namespace std;
+
+// named worker pool with queue-depth metrics
+// also works as httplib's task queue, so the connection pool is observable too
+class Executor : public httplib::TaskQueue
+{
+private:
+    string name;
+    struct Job
+    {
+        chrono::steady_clock::time_point queued;
+        function<void()> fn;
+    };
+
+    vector<thread> workers;
+    list<Job> jobs;
+    mutex mtx;
+    condition_variable cv;
+    bool stopping = false;
+
+    int threads = 0;
+    int max_queued = 0; // 0 = unbounded
+    int max_depth = 0;  // guarded by mtx
+    atomic<int> active{0};
+    atomic<long> completed{0};
+    atomic<long> rejected{0};
+    atomic<long> last_wait_us{0}; // queue sojourn of the latest job
+
+    void worker_loop()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [this]
+                        { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+
+            auto waited = chrono::steady_clock::now() - job.queued;
+            last_wait_us = chrono::duration_cast<chrono::microseconds>(waited).count();
+
+            active++;
+            job.fn();
+            active--;
+            completed++;
+        }
+    }
+
+public:
+    Executor(const string &n, int count, int queue_limit = 0)
+        : name(n), threads(count), max_queued(queue_limit)
+    {
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        for (int i = 0; i < threads; i++)
+        {
+            workers.emplace_back([this]
+                                 { worker_loop(); });
+        }
+    }
+
+    ~Executor() override { shutdown(); }
+
+    // queue a job, returns false once shut down or when the queue is full
+    bool enqueue(function<void()> fn) override
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            if (stopping)
+                return false;
+            if (max_queued > 0 && (int)jobs.size() >= max_queued)
+            {
+                rejected++;
+                return false;
+            }
+            jobs.push_back({chrono::steady_clock::now(), move(fn)});
+            if ((int)jobs.size() > max_depth)
+                max_depth = jobs.size();
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    // drain queued jobs and join workers (safe to call twice)
+    void shutdown() override
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &t : workers)
+        {
+            if (t.joinable())
+                t.join();
+        }
+        workers.clear();
+    }
+
+    // run fn on this pool, the future holds its result
+    template <typename F>
+    auto submit(F fn) -> future<decltype(fn())>
+    {
+        auto task = make_shared<packaged_task<decltype(fn())()>>(move(fn));
+        auto result = task->get_future();
+        if (!enqueue([task]
+                     { (*task)(); }))
+        {
+            (*task)(); // pool is full or gone, run inline
+        }
+        return result;
+    }
+
+    // run fn on this pool and block until it returns
+    template <typename F>
+    auto run(F fn) -> decltype(fn())
+    {
+        return submit(move(fn)).get();
+    }
+
+    // get stats
+    const string &get_name() { return name; }
+    int size() { return threads; }
+    int get_active() { return active; }
+    long get_completed() { return completed; }
+    long get_rejected() { return rejected; }
+    long get_last_wait_us() { return last_wait_us; }
+    int queue_depth()
+    {
+        lock_guard<mutex> lock(mtx);
+        return jobs.size();
+    }
+    int get_max_depth()
+    {
+        lock_guard<mutex> lock(mtx);
+        return max_depth;
+    }
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef HTTP_METRICS_H
+#define HTTP_METRICS_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "../include/metrics.h"
+#include "trace.h"
+
+using namespace std;
+
+// per-route request counts, status codes and latency for /metrics
+//
+// begin() runs in the pre-routing handler and end() in the post-routing
+// handler, both on the connection's worker thread, so the request in flight
+// is kept in a thread_local. Latency runs until the response headers are
+// ready: streamed bodies (/kv/scan, hash streams) are written after that.
+// Responses httplib sends before routing (malformed requests) count under
+// "other" without a latency.
+class HttpMetrics
+{
+private:
+    static const int MIN_CODE = 100, MAX_CODE = 600;
+
+    struct Pending
+    {
+        bool active = false;
+        Trace::Route route = Trace::OTHER;
+        chrono::steady_clock::time_point start;
+    };
+
+    static Pending &pending()
+    {
+        thread_local Pending p;
+        return p;
+    }
+
+    LatencyHistogram latency[Trace::ROUTES];
+    atomic<uint64_t> codes[Trace::ROUTES][MAX_CODE - MIN_CODE];
+    atomic<long> in_flight{0};
+
+public:
+    HttpMetrics()
+    {
+        for (auto &route : codes)
+        {
+            for (auto &c : route)
+                c.store(0, memory_order_relaxed);
+        }
+    }
+
+    // the request's route, for the caller to reuse
+    Trace::Route begin(const string &method, const string &path)
+    {
+        Pending &p = pending();
+        p.active = true;
+        p.route = Trace::route(method, path);
+        p.start = chrono::steady_clock::now();
+        in_flight.fetch_add(1, memory_order_relaxed);
+        return p.route;
+    }
+
+    void end(int status)
+    {
+        Pending &p = pending();
+        Trace::Route route = p.active ? p.route : Trace::OTHER;
+        if (p.active)
+        {
+            latency[route].record_since(p.start);
+            in_flight.fetch_sub(1, memory_order_relaxed);
+            p.active = false;
+        }
+        if (status >= MIN_CODE && status < MAX_CODE)
+            codes[route][status - MIN_CODE].fetch_add(1, memory_order_relaxed);
+    }
+
+    long get_in_flight() const { return in_flight.load(memory_order_relaxed); }
+
+    void write(string &out) const
+    {
+        Metrics::family(out, "kv_http_requests_total", "counter", "HTTP requests by route and status code.");
+        for (int r = 0; r < Trace::ROUTES; r++)
+        {
+            for (int c = 0; c < MAX_CODE - MIN_CODE; c++)
+            {
+                uint64_t n = codes[r][c].load(memory_order_relaxed);
+                if (n)
+                    Metrics::sample(out, "kv_http_requests_total", "route=\"" + string(Trace::name(r)) + "\",code=\"" + to_string(c + MIN_CODE) + "\"", n);
+            }
+        }
+
+        Metrics::family(out, "kv_http_request_duration_seconds", "histogram", "Time from routing to response headers, by route.");
+        for (int r = 0; r < Trace::ROUTES; r++)
+        {
+            if (latency[r].count())
+                latency[r].write(out, "kv_http_request_duration_seconds", "route=\"" + string(Trace::name(r)) + "\"");
+        }
+
+        Metrics::family(out, "kv_http_requests_in_flight", "gauge", "HTTP requests routed but not yet answered.");
+        Metrics::sample(out, "kv_http_requests_in_flight", "", get_in_flight());
+    }
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef KV_JSON_H
+#define KV_JSON_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// response bodies of the /kv routes, shared by the httplib handlers, the
+// pipelined listener and kv-bench. Strings go in as given: callers that
+// escape (the pipelined listener) pass them escaped.
+namespace KVJson
+{
+    // GET /kv/read hit, source is "cache" or "database"
+    inline string read(const string &key, const string &val, const char *source)
+    {
+        return "{\"success\": true, \"key\": \"" + key + "\", \"value\": \"" + val + "\", \"source\": \"" + source + "\"}";
+    }
+
+    // POST /kv/create, old_val only used when the key existed
+    inline string created(const string &key, const string &val, bool existed, const string &old_val)
+    {
+        string json = "{\"success\": true, \"message\": \"" + string(existed ? "Key overwritten" : "Key created") +
+                      "\", \"key\": \"" + key + "\", \"value\": \"" + val + "\", \"overwritten\": ";
+        json += existed ? "true, \"old_value\": \"" + old_val + "\"}" : "false}";
+        return json;
+    }
+
+    // GET /kv/mget, sources[i] is nullptr for a key that was not found
+    inline string mget(const vector<string> &keys, const vector<string> &vals, const vector<const char *> &sources, int found)
+    {
+        string json = "{\"success\": true, \"count\": " + to_string(keys.size()) + ", \"found\": " + to_string(found) + ", \"results\": [";
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (i > 0)
+                json += ", ";
+            if (sources[i])
+                json += "{\"key\": \"" + keys[i] + "\", \"found\": true, \"value\": \"" + vals[i] + "\", \"source\": \"" + sources[i] + "\"}";
+            else
+                json += "{\"key\": \"" + keys[i] + "\", \"found\": false}";
+        }
+        json += "]}";
+        return json;
+    }
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef KV_OPS_H
+#define KV_OPS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "../cache/cache.h"
+#include "../db/db.h"
+#include "kv_json.h"
+
+using namespace std;
+
+// kv operations shared by the non-httplib front ends
+// same tiering as the /kv routes: reads go cache then db, writes go db then cache
+class KVOps
+{
+private:
+    Cache *cache;
+    DB *db;
+
+public:
+    KVOps(Cache *c, DB *d) : cache(c), db(d) {}
+
+    // source is set to "cache" or "database" on a hit
+    bool read(const string &key, string &val, const char **source = nullptr)
+    {
+        if (cache->get(key, val))
+        {
+            if (source)
+                *source = "cache";
+            return true;
+        }
+        if (db->get(key, val))
+        {
+            cache->put(key, val); // fill cache
+            if (source)
+                *source = "database";
+            return true;
+        }
+        return false;
+    }
+
+    // batched read: one cache pass, then one db query for the misses
+    // sources[i] is "cache", "database" or nullptr when not found
+    int read_many(const vector<string> &keys, vector<string> &vals, vector<const char *> &sources)
+    {
+        vector<bool> found;
+        int n = cache->get_many(keys, vals, found);
+        sources.assign(keys.size(), nullptr);
+
+        vector<string> misses;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (found[i])
+                sources[i] = "cache";
+            else
+                misses.push_back(keys[i]);
+        }
+        if (misses.empty())
+            return n;
+
+        unordered_map<string, string> from_db;
+        db->get_many(misses, from_db);
+
+        vector<pair<string, string>> fill;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (found[i])
+                continue;
+            auto it = from_db.find(keys[i]);
+            if (it == from_db.end())
+                continue;
+            vals[i] = it->second;
+            sources[i] = "database";
+            fill.push_back(*it);
+            n++;
+        }
+        cache->put_many(fill); // fill cache
+        return n;
+    }
+
+    bool write(const string &key, const string &val)
+    {
+        if (!db->put(key, val))
+            return false;
+        cache->put(key, val);
+        return true;
+    }
+
+    bool write_many(const vector<pair<string, string>> &kvs)
+    {
+        if (!db->put_many(kvs))
+            return false;
+        cache->put_many(kvs);
+        return true;
+    }
+
+    // true if the key already had a value (old_val is set)
+    bool exists(const string &key, string &old_val) { return db->get(key, old_val); }
+
+    void remove(const string &key)
+    {
+        db->del(key);
+        cache->remove(key);
+    }
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef PIPELINE_SERVER_H
+#define PIPELINE_SERVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <sys/uio.h>
+#include "tcp_listener.h"
+#include "kv_ops.h"
+
+using namespace std;
+
+// HTTP/1.1 front end for the /kv routes that supports pipelining.
+// httplib builds a fresh stream per request and drops bytes it already read,
+// so pipelined requests on port 8080 are lost. Here every complete request in
+// the read buffer is handled, and the responses go back in order with writev.
+class PipelineServer : public TcpListener
+{
+private:
+    KVOps kv;
+    atomic<long> requests{0};
+    atomic<long> batches{0}; // writev batches, requests / batches = avg depth
+
+    const size_t MAX_HEADER = 64 * 1024;
+    const size_t MAX_BODY = 16 * 1024 * 1024;
+
+    struct Response
+    {
+        string head;
+        string body;
+    };
+
+    static string json_escape(const string &s)
+    {
+        string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    static int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // decode %XX and '+' like httplib does for query strings
+    static string url_decode(const string &s)
+    {
+        string out;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            if (s[i] == '%' && i + 2 < s.size() && hex_value(s[i + 1]) >= 0 && hex_value(s[i + 2]) >= 0)
+            {
+                out += (char)(hex_value(s[i + 1]) * 16 + hex_value(s[i + 2]));
+                i += 2;
+            }
+            else if (s[i] == '+')
+                out += ' ';
+            else
+                out += s[i];
+        }
+        return out;
+    }
+
+    static map<string, string> parse_query(const string &q)
+    {
+        map<string, string> params;
+        size_t pos = 0;
+        while (pos < q.size())
+        {
+            size_t end = q.find('&', pos);
+            if (end == string::npos)
+                end = q.size();
+            string pair = q.substr(pos, end - pos);
+            size_t eq = pair.find('=');
+            if (eq == string::npos)
+                params[url_decode(pair)] = "";
+            else
+                params[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+            pos = end + 1;
+        }
+        return params;
+    }
+
+    static const char *reason(int status)
+    {
+        switch (status)
+        {
+        case 200:
+            return "OK";
+        case 201:
+            return "Created";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 413:
+            return "Payload Too Large";
+        case 431:
+            return "Request Header Fields Too Large";
+        default:
+            return "Internal Server Error";
+        }
+    }
+
+    static Response make(int status, const string &json, bool close_conn)
+    {
+        static const string keep_alive = "Keep-Alive: timeout=" + to_string(Config::IDLE_TIMEOUT_S) + "\r\n\r\n";
+        Response r;
+        r.body = json;
+        r.head = "HTTP/1.1 " + to_string(status) + " " + reason(status) + "\r\n";
+        r.head += "Content-Type: application/json\r\n";
+        r.head += "Content-Length: " + to_string(json.size()) + "\r\n";
+        r.head += close_conn ? "Connection: close\r\n\r\n" : keep_alive;
+        return r;
+    }
+
+    // same responses as the httplib /kv handlers
+    Response route(const string &method, const string &target, bool close_conn)
+    {
+        requests++;
+
+        size_t q = target.find('?');
+        string path = target.substr(0, q);
+        auto params = parse_query(q == string::npos ? "" : target.substr(q + 1));
+        string key = params.count("key") ? params["key"] : "";
+
+        if (method == "GET" && path == "/kv/read")
+        {
+            if (!params.count("key"))
+                return make(400, "{\"error\": \"missing key\"}", close_conn);
+
+            string val;
+            const char *source = "";
+            if (kv.read(key, val, &source))
+                return make(200, KVJson::read(json_escape(key), json_escape(val), source), close_conn);
+            return make(404, "{\"error\": \"Key not found\", \"key\": \"" + json_escape(key) + "\"}", close_conn);
+        }
+
+        if (method == "POST" && path == "/kv/create")
+        {
+            string val = params.count("value") ? params["value"] : "";
+            if (key.empty())
+                return make(400, "{\"error\": \"missing key\"}", close_conn);
+
+            string old_val;
+            bool key_exists = kv.exists(key, old_val);
+            if (!kv.write(key, val))
+                return make(500, "{\"error\": \"db error\"}", close_conn);
+
+            return make(201, KVJson::created(json_escape(key), json_escape(val), key_exists, json_escape(old_val)), close_conn);
+        }
+
+        if (method == "DELETE" && path == "/kv/delete")
+        {
+            if (!params.count("key"))
+                return make(400, "{\"error\": \"missing key\"}", close_conn);
+            kv.remove(key);
+            return make(200, "{\"success\": true, \"message\": \"Deleted\", \"key\": \"" + json_escape(key) + "\"}", close_conn);
+        }
+
+        string hint = "Pipelined endpoints: /kv/create (POST), /kv/read (GET), /kv/delete (DELETE)";
+        return make(404, "{\"error\": \"endpoint not found\", \"method\": \"" + json_escape(method) + "\", \"path\": \"" + json_escape(path) +
+                             "\", \"status\": 404, \"hint\": \"" + hint + "\"}",
+                    close_conn);
+    }
+
+    // write all responses in order, header and body as separate iovecs
+    bool write_batch(int fd, vector<Response> &out)
+    {
+        vector<iovec> iov;
+        for (auto &r : out)
+        {
+            iov.push_back({(void *)r.head.data(), r.head.size()});
+            if (!r.body.empty())
+                iov.push_back({(void *)r.body.data(), r.body.size()});
+        }
+        batches++;
+
+        size_t i = 0;
+        while (i < iov.size())
+        {
+            int cnt = min((size_t)IOV_MAX, iov.size() - i);
+            ssize_t n = writev(fd, &iov[i], cnt);
+            if (n <= 0)
+                return false;
+
+            // skip fully written iovecs, trim a partially written one
+            while (i < iov.size() && n >= (ssize_t)iov[i].iov_len)
+            {
+                n -= iov[i].iov_len;
+                i++;
+            }
+            if (n > 0)
+            {
+                iov[i].iov_base = (char *)iov[i].iov_base + n;
+                iov[i].iov_len -= n;
+            }
+        }
+        return true;
+    }
+
+    void serve(int fd) override
+    {
+        string buf;
+        char chunk[16384];
+        bool done = false;
+        auto deadline = clock::now() + idle_timeout;
+
+        while (!done)
+        {
+            ssize_t n = recv_by(fd, chunk, sizeof(chunk), deadline);
+            if (n <= 0)
+                break;
+            bool was_empty = buf.empty();
+            buf.append(chunk, n);
+
+            // handle every complete request in the buffer
+            vector<Response> out;
+            size_t pos = 0;
+            while (!done)
+            {
+                size_t hdr_end = buf.find("\r\n\r\n", pos);
+                if (hdr_end == string::npos)
+                {
+                    if (buf.size() - pos > MAX_HEADER)
+                    {
+                        out.push_back(make(431, "{\"error\": \"headers too large\"}", true));
+                        done = true;
+                    }
+                    break;
+                }
+
+                // request line
+                size_t line_end = buf.find("\r\n", pos);
+                string line = buf.substr(pos, line_end - pos);
+                size_t sp1 = line.find(' ');
+                size_t sp2 = line.rfind(' ');
+                if (sp1 == string::npos || sp2 == sp1)
+                {
+                    out.push_back(make(400, "{\"error\": \"bad request line\"}", true));
+                    done = true;
+                    break;
+                }
+                string method = line.substr(0, sp1);
+                string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+                bool close_conn = line.compare(sp2 + 1, string::npos, "HTTP/1.0") == 0;
+
+                // headers we care about
+                size_t content_length = 0;
+                size_t h = line_end + 2;
+                while (h < hdr_end)
+                {
+                    size_t e = buf.find("\r\n", h);
+                    string header = buf.substr(h, e - h);
+                    h = e + 2;
+                    size_t colon = header.find(':');
+                    if (colon == string::npos)
+                        continue;
+                    string name = header.substr(0, colon);
+                    for (auto &c : name)
+                        c = tolower(c);
+                    string value = header.substr(colon + 1);
+                    value.erase(0, value.find_first_not_of(' '));
+                    for (auto &c : value)
+                        c = tolower(c);
+                    if (name == "content-length")
+                        content_length = strtoul(value.c_str(), nullptr, 10);
+                    else if (name == "connection")
+                        close_conn = value == "close";
+                }
+
+                if (content_length > MAX_BODY)
+                {
+                    out.push_back(make(413, "{\"error\": \"body too large\"}", true));
+                    done = true;
+                    break;
+                }
+                size_t end = hdr_end + 4 + content_length;
+                if (buf.size() < end)
+                    break; // body not here yet, wait for more bytes
+
+                // body is unused, /kv routes take query params
+                out.push_back(route(method, target, close_conn));
+                pos = end;
+                done = close_conn;
+            }
+            buf.erase(0, pos);
+            deadline = next_deadline(!buf.empty(), was_empty || pos > 0, deadline);
+
+            if (!out.empty() && !write_batch(fd, out))
+                break;
+        }
+    }
+
+public:
+    PipelineServer(Cache *c, DB *d, int threads) : TcpListener("pipeline", threads), kv(c, d) {}
+
+    ~PipelineServer() override { stop(); }
+
+    // get stats
+    long get_requests() { return requests; }
+    long get_batches() { return batches; }
+};
+
+#endif
@@ -2,9 +2,26 @@
 #define SERVER_H
 
 #include <string>
+#include <set>
+// httplib listens with a backlog of 5; bursts of new connections overflow it and
+// the dropped SYNs are retried only after 1 s. Same backlog as TcpListener
+#define CPPHTTPLIB_LISTEN_BACKLOG 1024
 #include "../include/httplib.h"
 #include "../cache/cache.h"
+#include "../cache/hash_cache.h"
 #include "../db/db.h"
+#include "executor.h"
+#include "admission.h"
+#include "cost_model.h"
+#include "binary_server.h"
+#include "pipeline_server.h"
+#include "kv_json.h"
+#include "trace.h"
+#include "http_metrics.h"
+#include "../include/profile.h"
+#include "../compute/primes.h"
+#include "../compute/sieve.h"
+#include "../compute/hash.h"
 
 using namespace std;
 
@@ -14,17 +31,281 @@ class Server
 private:
     httplib::Server srv;
     Cache *cache;
-    Cache *hash_cache; // separate cache for hash computations
+    HashCache *hash_cache; // separate cache for hash computations, keyed by fingerprint
     DB *db;
+    KVOps kv; // batched cache + db operations
+
+    CostModel hash_cost; // which tiers /compute/hash results are worth
+    atomic<long> hash_from_cache{0};
+    atomic<long> hash_from_db{0};
+    atomic<long> hash_from_computed{0}; // computed after tier misses, then stored
+    atomic<long> hash_from_inline{0};   // computed without touching any tier
+
+    PrimeTable prime_table;      // first MAX_PRIMES primes, built at startup
+    PrimeSieve sieve;            // ranges, nth prime, primality
+    Executor compute_pool;       // CPU-bound routes
+    Executor *io_pool = nullptr; // owned by httplib while listening
+    Admission io_admit;
+    Admission compute_admit;
+    set<string> compute_routes; // routes whose handlers run on compute_pool
+    BinaryServer *binary = nullptr;     // optional extra listeners, for /status
+    PipelineServer *pipeline = nullptr;
+    TraceRecorder *trace = nullptr;     // optional request trace
+    HttpMetrics http_metrics;           // per-route counts and latency, /metrics
+
+    // unsigned 64-bit query param, false if missing or not a number
+    static bool param_u64(const httplib::Request &req, const string &name, uint64_t &out)
+    {
+        if (!req.has_param(name))
+            return false;
+        string v = req.get_param_value(name);
+        if (v.empty() || v.find_first_not_of("0123456789") != string::npos)
+            return false;
+        try {
+            out = stoull(v);
+        } catch (const exception &) {
+            return false;
+        }
+        return true;
+    }
+
+    static void bad_request(httplib::Response &res, const string &msg)
+    {
+        cout << "  [ERROR] " << msg << endl;
+        res.status = 400;
+        res.set_content("{\"error\": \"" + msg + "\"}", "application/json");
+        cout << "  [RESPONSE] 400 Bad Request" << endl;
+    }
+
+    // keys for a batch request: repeated key= params and/or keys=a,b,c
+    static vector<string> batch_keys(const httplib::Request &req)
+    {
+        vector<string> keys;
+        for (size_t i = 0; i < req.get_param_value_count("key"); i++)
+            keys.push_back(req.get_param_value("key", i));
+        if (req.has_param("keys"))
+        {
+            string list = req.get_param_value("keys");
+            size_t pos = 0;
+            while (pos <= list.size())
+            {
+                size_t end = list.find(',', pos);
+                if (end == string::npos)
+                    end = list.size();
+                if (end > pos)
+                    keys.push_back(list.substr(pos, end - pos));
+                pos = end + 1;
+            }
+        }
+        return keys;
+    }
+
+    // one /kv/bulk_load row, "key<TAB>value" with LOAD DATA's default
+    // escapes (\t \n \r \0 \\), false if it has no tab or no key
+    static bool parse_row(const string &line, string &key, string &val)
+    {
+        key.clear();
+        val.clear();
+        string *out = &key;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            char c = line[i];
+            if (c == '\t' && out == &key)
+            {
+                out = &val;
+                continue;
+            }
+            if (c == '\\' && i + 1 < line.size())
+            {
+                c = line[++i];
+                c = c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c == '0' ? '\0' : c;
+            }
+            *out += c;
+        }
+        return out == &val && !key.empty();
+    }
+
+    // one trace record per incoming request, taken before admission so shed
+    // requests count as offered load too. Only the query string and headers
+    // are read here, bodies have not arrived yet
+    void trace_request(const httplib::Request &req)
+    {
+        auto key_hash = [](const string &s)
+        { return Hash::xxh3(s.data(), s.size()); };
+        Trace::Route route = Trace::route(req.method, req.path);
+        uint64_t key = 0, n = 0;
+        uint32_t size = 0;
+        uint16_t extra = 0;
+
+        switch (route)
+        {
+        case Trace::KV_CREATE:
+            key = key_hash(req.get_param_value("key"));
+            size = req.has_param("value") ? req.get_param_value("value").size()
+                                          : req.get_header_value_u64("Content-Length");
+            break;
+        case Trace::KV_READ:
+        case Trace::KV_DELETE:
+            key = key_hash(req.get_param_value("key"));
+            break;
+        case Trace::KV_MGET:
+        {
+            vector<string> keys = batch_keys(req);
+            key = keys.empty() ? 0 : key_hash(keys[0]);
+            size = keys.size();
+            break;
+        }
+        case Trace::KV_MPUT:
+        {
+            size_t pairs = req.get_param_value_count("key"), bytes = 0;
+            for (size_t i = 0; i < req.get_param_value_count("value"); i++)
+                bytes += req.get_param_value("value", i).size();
+            key = pairs ? key_hash(req.get_param_value("key", 0)) : 0;
+            size = pairs;
+            extra = pairs ? min<size_t>(bytes / pairs, UINT16_MAX) : 0;
+            break;
+        }
+        case Trace::KV_SCAN:
+            key = key_hash(req.get_param_value("prefix"));
+            size = param_u64(req, "limit", n) ? min<uint64_t>(n, UINT32_MAX) : 100;
+            break;
+        case Trace::PRIME:
+            size = param_u64(req, "count", n) ? min<uint64_t>(n, UINT32_MAX) : 0;
+            break;
+        case Trace::IS_PRIME:
+        case Trace::NTH_PRIME:
+            param_u64(req, "n", key);
+            break;
+        case Trace::PRIMES:
+            if (param_u64(req, "from", key) && param_u64(req, "to", n) && n >= key)
+                size = min<uint64_t>(n - key, UINT32_MAX);
+            break;
+        case Trace::HASH:
+        case Trace::HASH_STREAM:
+        {
+            Hash::Algo algo = Hash::POLY31;
+            Hash::parse(req.get_param_value("algo"), algo);
+            extra = algo;
+            if (route == Trace::HASH)
+            {
+                string text = req.get_param_value("text");
+                key = key_hash(text);
+                size = text.size();
+            }
+            else
+            {
+                size = req.get_header_value_u64("Content-Length");
+            }
+            break;
+        }
+        case Trace::KV_BULK_LOAD:
+            size = min<uint64_t>(req.get_header_value_u64("Content-Length"), UINT32_MAX);
+            break;
+        default:
+            break;
+        }
+        trace->record(route, key, size, extra);
+    }
+
+    // pool and admission metrics, each family over both pools (pool="io", "compute")
+    void pool_metrics(string &out)
+    {
+        struct Pool
+        {
+            const char *name;
+            Executor *p;
+            Admission *a;
+        };
+        Pool pools[] = {{"io", io_pool, &io_admit}, {"compute", &compute_pool, &compute_admit}};
+        auto family = [&](const string &name, const char *type, const char *help, function<double(Pool &)> value)
+        {
+            Metrics::family(out, name, type, help);
+            for (auto &pl : pools)
+                Metrics::sample(out, name, "pool=\"" + string(pl.name) + "\"", pl.p ? value(pl) : 0);
+        };
+        family("kv_pool_threads", "gauge", "Worker threads.", [](Pool &pl)
+               { return pl.p->size(); });
+        family("kv_pool_active", "gauge", "Workers running a job (in-flight connections or requests).", [](Pool &pl)
+               { return pl.p->get_active(); });
+        family("kv_pool_queue_depth", "gauge", "Jobs waiting for a worker.", [](Pool &pl)
+               { return pl.p->queue_depth(); });
+        family("kv_pool_queue_wait_seconds", "gauge", "Queue wait of the latest job started.", [](Pool &pl)
+               { return pl.p->get_last_wait_us() / 1e6; });
+        family("kv_pool_completed_total", "counter", "Jobs completed.", [](Pool &pl)
+               { return pl.p->get_completed(); });
+        family("kv_pool_rejected_total", "counter", "Jobs refused with the queue full.", [](Pool &pl)
+               { return pl.p->get_rejected(); });
+
+        Metrics::family(out, "kv_pool_shed_total", "counter", "Requests shed with 503 by admission control.");
+        for (auto &pl : pools)
+        {
+            Metrics::sample(out, "kv_pool_shed_total", "pool=\"" + string(pl.name) + "\",reason=\"queue\"", pl.a->get_shed_queue());
+            Metrics::sample(out, "kv_pool_shed_total", "pool=\"" + string(pl.name) + "\",reason=\"sojourn\"", pl.a->get_shed_sojourn());
+        }
+    }
+
+    // pool and admission stats as JSON fields, e.g. "io_pool_queue_depth": 3
+    static string pool_stats(const string &prefix, Executor *p, Admission &a)
+    {
+        string json;
+        json += "\"" + prefix + "_admitted\": " + to_string(a.get_admitted()) + ", ";
+        json += "\"" + prefix + "_shed_queue\": " + to_string(a.get_shed_queue()) + ", ";
+        json += "\"" + prefix + "_shed_sojourn\": " + to_string(a.get_shed_sojourn()) + ", ";
+        json += "\"" + prefix + "_dropping\": " + string(a.is_dropping() ? "true" : "false") + ", ";
+        if (!p)
+            return json + "\"" + prefix + "_threads\": 0";
+        json += "\"" + prefix + "_threads\": " + to_string(p->size()) + ", ";
+        json += "\"" + prefix + "_active\": " + to_string(p->get_active()) + ", ";
+        json += "\"" + prefix + "_queue_depth\": " + to_string(p->queue_depth()) + ", ";
+        json += "\"" + prefix + "_max_queue_depth\": " + to_string(p->get_max_depth()) + ", ";
+        json += "\"" + prefix + "_completed\": " + to_string(p->get_completed()) + ", ";
+        json += "\"" + prefix + "_rejected\": " + to_string(p->get_rejected());
+        return json;
+    }
 
 public:
-    Server(Cache *c, Cache *hc, DB *d) : cache(c), hash_cache(hc), db(d)
+    Server(Cache *c, HashCache *hc, DB *d)
+        : cache(c), hash_cache(hc), db(d), kv(c, d),
+          hash_cost(Config::HASH_COST_PROBE),
+          prime_table(Config::MAX_PRIMES),
+          compute_pool("compute", Config::COMPUTE_THREADS),
+          io_admit(Config::IO_QUEUE_LIMIT, Config::SHED_TARGET_MS, Config::SHED_INTERVAL_MS),
+          compute_admit(Config::COMPUTE_QUEUE_LIMIT, Config::SHED_TARGET_MS, Config::SHED_INTERVAL_MS)
     {
         setup();
     }
 
     void setup()
     {
+        // admission control - shed early with 503 rather than queue without bound
+        srv.set_pre_routing_handler([this](const httplib::Request &req, httplib::Response &res)
+                                    {
+            Trace::Route route = http_metrics.begin(req.method, req.path);
+            if (Profile::begin_request(route))
+                Profile::record_ns(Profile::HTTP_PARSE, Metrics::since_ns(req.start_time_));
+            ProfileTimer admission(Profile::ADMISSION);
+            if (trace) trace_request(req);
+
+            bool compute = compute_routes.count(req.path) > 0;
+            Executor *pool = compute ? &compute_pool : io_pool;
+            Admission &adm = compute ? compute_admit : io_admit;
+            if (!pool || adm.admit(pool->queue_depth(), pool->get_last_wait_us())) {
+                return httplib::Server::HandlerResponse::Unhandled;
+            }
+
+            cout << "\n[REQUEST] " << req.method << " " << req.path << " from " << req.remote_addr << endl;
+            res.status = 503;
+            res.set_header("Retry-After", to_string(Config::RETRY_AFTER_S));
+            res.set_content("{\"error\": \"server overloaded\", \"retry_after\": " + to_string(Config::RETRY_AFTER_S) + "}", "application/json");
+            cout << "  [RESPONSE] 503 Service Unavailable (shed)" << endl;
+            return httplib::Server::HandlerResponse::Handled; });
+
+        // every response, shed and error ones included, before it is written
+        srv.set_post_routing_handler([this](const httplib::Request &, httplib::Response &res)
+                                     {
+            http_metrics.end(res.status);
+            Profile::end_request(); });
+
         // create key-value
         srv.Post("/kv/create", [this](const httplib::Request &req, httplib::Response &res)
                  {
@@ -69,21 +350,17 @@ public:
             }
             
             // then cache
+            ProfileTimer fill(Profile::CACHE);
             cache->put(key, val);
+            fill.stop();
             cout << "  ✓ Written to cache" << endl;
             
-            string response_msg = key_exists ? "Key overwritten" : "Key created";
-            // build JSON response with overwritten flag and old_value when applicable
-            string json = "{\"success\": true, \"message\": \"" + response_msg + "\", \"key\": \"" + key + "\", \"value\": \"" + val + "\", \"overwritten\": ";
-            json += (key_exists ? "true" : "false");
-            if (key_exists) {
-                json += ", \"old_value\": \"" + old_val + "\"";
-            }
-            json += "}";
-
+            // JSON response with overwritten flag and old_value when applicable
+            ProfileTimer json_timer(Profile::JSON);
             res.status = 201;
-            res.set_content(json, "application/json");
-            cout << "  [RESPONSE] 201 Created - " << response_msg << endl; });
+            res.set_content(KVJson::created(key, val, key_exists, old_val), "application/json");
+            json_timer.stop();
+            cout << "  [RESPONSE] 201 Created - " << (key_exists ? "Key overwritten" : "Key created") << endl; });
 
         // read key-value
         srv.Get("/kv/read", [this](const httplib::Request &req, httplib::Response &res)
@@ -105,10 +382,15 @@ public:
             
             // check cache first
             cout << "  Checking cache..." << endl;
-            if (cache->get(key, val)) {
+            ProfileTimer lookup(Profile::CACHE);
+            bool hit = cache->get(key, val);
+            lookup.stop();
+            if (hit) {
                 cout << "  ✓ CACHE HIT - Value: '" << val << "'" << endl;
                 res.status = 200;
-                res.set_content("{\"success\": true, \"key\": \"" + key + "\", \"value\": \"" + val + "\", \"source\": \"cache\"}", "application/json");
+                ProfileTimer json(Profile::JSON);
+                res.set_content(KVJson::read(key, val, "cache"), "application/json");
+                json.stop();
                 cout << "  [RESPONSE] 200 OK (from cache)" << endl;
                 return;
             }
@@ -118,10 +400,14 @@ public:
             // check db
             if (db->get(key, val)) {
                 cout << "  ✓ Found in database - Value: '" << val << "'" << endl;
+                ProfileTimer fill(Profile::CACHE);
                 cache->put(key, val);  // fill cache
+                fill.stop();
                 cout << "  ✓ Cached for future requests" << endl;
                 res.status = 200;
-                res.set_content("{\"success\": true, \"key\": \"" + key + "\", \"value\": \"" + val + "\", \"source\": \"database\"}", "application/json");
+                ProfileTimer json(Profile::JSON);
+                res.set_content(KVJson::read(key, val, "database"), "application/json");
+                json.stop();
                 cout << "  [RESPONSE] 200 OK (from database)" << endl;
                 return;
             }
@@ -129,7 +415,9 @@ public:
             cout << "  ✗ Key not found in database" << endl;
             
             res.status = 404;
+            ProfileTimer json(Profile::JSON);
             res.set_content("{\"error\": \"Key not found\", \"key\": \"" + key + "\"}", "application/json");
+            json.stop();
             cout << "  [RESPONSE] 404 Not Found" << endl; });
 
         // delete key-value
@@ -151,15 +439,220 @@ public:
             cout << "  Deleting from database..." << endl;
             db->del(key);
             cout << "  Deleting from cache..." << endl;
+            ProfileTimer evict(Profile::CACHE);
             cache->remove(key);
+            evict.stop();
             
             cout << "  ✓ Deleted from both database and cache" << endl;
             res.status = 200;
             res.set_content("{\"success\": true, \"message\": \"Deleted\", \"key\": \"" + key + "\"}", "application/json");
             cout << "  [RESPONSE] 200 OK" << endl; });
 
+        // read many keys: one cache pass, one db query for the misses
+        srv.Get("/kv/mget", [this](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /kv/mget from " << req.remote_addr << endl;
+            
+            vector<string> keys = batch_keys(req);
+            if (keys.empty() || (int)keys.size() > Config::MAX_BATCH) {
+                cout << "  [ERROR] Need 1-" << Config::MAX_BATCH << " keys, got " << keys.size() << endl;
+                res.status = 400;
+                res.set_content("{\"error\": \"need 1-" + to_string(Config::MAX_BATCH) + " keys\"}", "application/json");
+                cout << "  [RESPONSE] 400 Bad Request" << endl;
+                return;
+            }
+            
+            vector<string> vals;
+            vector<const char *> sources;
+            int found = kv.read_many(keys, vals, sources);
+            cout << "  Keys: " << keys.size() << ", found: " << found << endl;
+            
+            ProfileTimer json_timer(Profile::JSON);
+            res.status = 200;
+            res.set_content(KVJson::mget(keys, vals, sources, found), "application/json");
+            json_timer.stop();
+            cout << "  [RESPONSE] 200 OK" << endl; });
+
+        // write many pairs: key=..&value=.. repeated, paired in order
+        srv.Post("/kv/mput", [this](const httplib::Request &req, httplib::Response &res)
+                 {
+            cout << "\n[REQUEST] POST /kv/mput from " << req.remote_addr << endl;
+            
+            size_t n = req.get_param_value_count("key");
+            if (n == 0 || (int)n > Config::MAX_BATCH || req.get_param_value_count("value") != n) {
+                cout << "  [ERROR] Need 1-" << Config::MAX_BATCH << " key/value pairs" << endl;
+                res.status = 400;
+                res.set_content("{\"error\": \"need 1-" + to_string(Config::MAX_BATCH) + " key/value pairs\"}", "application/json");
+                cout << "  [RESPONSE] 400 Bad Request" << endl;
+                return;
+            }
+            
+            vector<pair<string, string>> kvs;
+            for (size_t i = 0; i < n; i++) {
+                string key = req.get_param_value("key", i);
+                if (key.empty()) {
+                    res.status = 400;
+                    res.set_content("{\"error\": \"missing key\"}", "application/json");
+                    cout << "  [RESPONSE] 400 Bad Request" << endl;
+                    return;
+                }
+                kvs.push_back({key, req.get_param_value("value", i)});
+            }
+            
+            // one multi-row insert, then cache
+            cout << "  Writing " << n << " pairs to database..." << endl;
+            if (!kv.write_many(kvs)) {
+                cout << "  [ERROR] Database write failed" << endl;
+                res.status = 500;
+                res.set_content("{\"error\": \"db error\"}", "application/json");
+                cout << "  [RESPONSE] 500 Internal Error" << endl;
+                return;
+            }
+            
+            res.status = 201;
+            res.set_content("{\"success\": true, \"message\": \"Keys written\", \"count\": " + to_string(n) + "}", "application/json");
+            cout << "  [RESPONSE] 201 Created" << endl; });
+
+        // load rows from the request body as it streams in, LOAD DATA style:
+        // one "key<TAB>value" line per row, written in multi-row inserts of
+        // bulk_batch rows. Loaded keys leave the cache, so it warms from
+        // reads as it would after a restart instead of holding the load's tail
+        srv.Post("/kv/bulk_load", [this](const httplib::Request &req, httplib::Response &res, const httplib::ContentReader &content_reader)
+                 {
+            cout << "\n[REQUEST] POST /kv/bulk_load from " << req.remote_addr << endl;
+            
+            // also flush by size, well under MySQL's default max_allowed_packet
+            const size_t BATCH_BYTES = 1 << 20;
+            vector<pair<string, string>> batch;
+            size_t batch_bytes = 0, rows = 0, batches = 0, line_no = 0;
+            string line, error;
+            int status = 201;
+            
+            auto flush = [&]() {
+                if (batch.empty()) return;
+                if (!db->put_many(batch)) {
+                    error = "db error after " + to_string(rows) + " rows";
+                    status = 500;
+                    return;
+                }
+                for (auto &row : batch) cache->remove(row.first);
+                rows += batch.size();
+                batches++;
+                batch.clear();
+                batch_bytes = 0;
+            };
+            auto add_row = [&]() {
+                line_no++;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.empty()) return;
+                string key, val;
+                if (!parse_row(line, key, val)) {
+                    error = "line " + to_string(line_no) + ": expected key<TAB>value";
+                    status = 400;
+                    return;
+                }
+                batch_bytes += key.size() + val.size();
+                batch.push_back({move(key), move(val)});
+                if ((int)batch.size() >= Config::BULK_BATCH || batch_bytes >= BATCH_BYTES) flush();
+            };
+            
+            content_reader([&](const char *data, size_t len) {
+                const char *end = data + len;
+                while (data < end && error.empty()) {
+                    const char *nl = (const char *)memchr(data, '\n', end - data);
+                    if (!nl) {
+                        line.append(data, end);
+                        break;
+                    }
+                    line.append(data, nl);
+                    add_row();
+                    line.clear();
+                    data = nl + 1;
+                }
+                return error.empty();
+            });
+            if (error.empty()) add_row(); // last line without a newline
+            if (error.empty()) flush();
+            
+            if (!error.empty()) {
+                cout << "  [ERROR] " << error << " (" << rows << " rows loaded)" << endl;
+                res.status = status;
+                res.set_content("{\"error\": \"" + error + "\", \"rows\": " + to_string(rows) + "}", "application/json");
+                cout << "  [RESPONSE] " << status << (status == 400 ? " Bad Request" : " Internal Error") << endl;
+                return;
+            }
+            
+            cout << "  ✓ " << rows << " rows loaded in " << batches << " inserts" << endl;
+            res.status = 201;
+            res.set_content("{\"success\": true, \"rows\": " + to_string(rows) + ", \"batches\": " + to_string(batches) + "}", "application/json");
+            cout << "  [RESPONSE] 201 Created" << endl; });
+
+        // scan keys in order, streamed as chunks one db page at a time
+        srv.Get("/kv/scan", [this](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /kv/scan from " << req.remote_addr << endl;
+            
+            struct Scan {
+                string prefix, start, last;
+                int left = 0;
+                int count = 0;
+                bool done = false;
+            };
+            auto scan = make_shared<Scan>();
+            scan->prefix = req.get_param_value("prefix");
+            scan->start = req.get_param_value("start");
+            scan->last = req.get_param_value("after"); // cursor from a previous scan
+            uint64_t limit = 100;
+            if (req.has_param("limit") && (!param_u64(req, "limit", limit) || limit == 0)) {
+                bad_request(res, "limit must be a positive integer");
+                return;
+            }
+            scan->left = (int)min<uint64_t>(limit, Config::SCAN_MAX);
+            
+            cout << "  Prefix: '" << scan->prefix << "', start: '" << scan->start << "', limit: " << scan->left << endl;
+            
+            res.status = 200;
+            res.set_chunked_content_provider("application/json", [this, scan](size_t offset, httplib::DataSink &sink) {
+                if (offset == 0) {
+                    string head = "{\"success\": true, \"prefix\": \"" + scan->prefix + "\", \"results\": [";
+                    sink.write(head.data(), head.size());
+                }
+                
+                // next page, continuing after the last key sent
+                vector<pair<string, string>> rows;
+                int page = min(scan->left, Config::SCAN_PAGE);
+                bool ok = db->scan(scan->prefix, scan->start, scan->last, page, rows);
+                
+                string chunk;
+                for (auto &row : rows) {
+                    if (scan->count > 0) chunk += ", ";
+                    chunk += "{\"key\": \"" + row.first + "\", \"value\": \"" + row.second + "\"}";
+                    scan->count++;
+                }
+                if (!rows.empty()) scan->last = rows.back().first;
+                scan->left -= rows.size();
+                
+                // short page means we ran out of keys
+                bool more = ok && (int)rows.size() == page;
+                if (!ok || !more || scan->left == 0) {
+                    chunk += "], \"count\": " + to_string(scan->count);
+                    if (more) chunk += ", \"next\": \"" + scan->last + "\"";
+                    if (!ok) chunk += ", \"error\": \"db error\"";
+                    chunk += "}";
+                    scan->done = true;
+                }
+                
+                if (!chunk.empty() && !sink.write(chunk.data(), chunk.size())) return false;
+                if (scan->done) {
+                    cout << "  ✓ Scan streamed " << scan->count << " keys" << endl;
+                    sink.done();
+                }
+                return true;
+            });
+            cout << "  [RESPONSE] 200 OK (streaming)" << endl; });
+
         // get primes
-        srv.Get("/compute/prime", [](const httplib::Request &req, httplib::Response &res)
+        srv.Get("/compute/prime", [this](const httplib::Request &req, httplib::Response &res)
                 {
             cout << "\n[REQUEST] GET /compute/prime from " << req.remote_addr << endl;
             
@@ -167,31 +660,103 @@ public:
             if (req.has_param("count")) {
                 n = stoi(req.get_param_value("count"));
             }
-            if (n > 10000) n = 10000;
+            if (n > prime_table.size()) n = prime_table.size();
+            if (n < 0) n = 0;
             
-            cout << "  Computing first " << n << " prime numbers..." << endl;
+            // copy a prefix of the pre-rendered table, no computation per request
+            ProfileTimer json_timer(Profile::JSON);
+            string json;
+            json.reserve(64 + n * 6);
+            json += "{\"success\": true, \"count\": " + to_string(n) + ", \"primes\": \"";
+            prime_table.append_first(n, json);
+            json += "\"}";
             
-            string result;
-            int count = 0, num = 2;
-            while (count < n) {
-                bool is_prime = true;
-                for (int i = 2; i * i <= num; i++) {
-                    if (num % i == 0) {
-                        is_prime = false;
-                        break;
-                    }
-                }
-                if (is_prime) {
-                    if (count > 0) result += ",";
-                    result += to_string(num);
-                    count++;
-                }
-                num++;
+            cout << "  ✓ Served first " << n << " primes from table" << endl;
+            res.status = 200;
+            res.set_content(move(json), "application/json");
+            json_timer.stop();
+            cout << "  [RESPONSE] 200 OK" << endl; });
+
+        // primality test, deterministic Miller-Rabin for any 64-bit n
+        srv.Get("/compute/is_prime", [](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /compute/is_prime from " << req.remote_addr << endl;
+            
+            uint64_t n;
+            if (!param_u64(req, "n", n)) {
+                bad_request(res, "n must be an unsigned 64-bit integer");
+                return;
+            }
+            
+            bool prime = PrimeSieve::is_prime(n);
+            cout << "  " << n << (prime ? " is prime" : " is not prime") << endl;
+            res.status = 200;
+            res.set_content("{\"success\": true, \"n\": " + to_string(n) + ", \"is_prime\": " + (prime ? "true" : "false") + "}", "application/json");
+            cout << "  [RESPONSE] 200 OK" << endl; });
+
+        // primes in [from, to]: count over the compute pool, list the first PRIME_LIST_MAX
+        compute_routes.insert("/compute/primes");
+        srv.Get("/compute/primes", [this](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /compute/primes from " << req.remote_addr << endl;
+            
+            uint64_t from, to;
+            if (!param_u64(req, "from", from) || !param_u64(req, "to", to) || from > to) {
+                bad_request(res, "need from <= to");
+                return;
+            }
+            if (to > PrimeSieve::MAX_VALUE || to - from >= (uint64_t)Config::SIEVE_MAX_SPAN) {
+                bad_request(res, "range too large (to <= 1e14, span < " + to_string(Config::SIEVE_MAX_SPAN) + ")");
+                return;
             }
             
-            cout << "  ✓ Computed " << n << " primes" << endl;
+            cout << "  Sieving [" << from << ", " << to << "] (compute pool)..." << endl;
+            ProfileTimer compute(Profile::COMPUTE);
+            uint64_t count = sieve.count(from, to, &compute_pool);
+            vector<uint64_t> primes = compute_pool.run([this, from, to] {
+                return sieve.list(from, to, Config::PRIME_LIST_MAX);
+            });
+            compute.stop();
+            
+            string json = "{\"success\": true, \"from\": " + to_string(from) + ", \"to\": " + to_string(to) + ", \"count\": " + to_string(count) + ", \"primes\": [";
+            for (size_t i = 0; i < primes.size(); i++) {
+                if (i > 0) json += ",";
+                json += to_string(primes[i]);
+            }
+            json += "], \"truncated\": ";
+            json += primes.size() < count ? "true}" : "false}";
+            
+            cout << "  ✓ " << count << " primes" << endl;
             res.status = 200;
-            res.set_content("{\"success\": true, \"count\": " + to_string(n) + ", \"primes\": \"" + result + "\"}", "application/json");
+            res.set_content(move(json), "application/json");
+            cout << "  [RESPONSE] 200 OK" << endl; });
+
+        // nth prime (1-based): table lookup, else a parallel sieve count
+        compute_routes.insert("/compute/nth_prime");
+        srv.Get("/compute/nth_prime", [this](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /compute/nth_prime from " << req.remote_addr << endl;
+            
+            uint64_t n;
+            if (!param_u64(req, "n", n) || n == 0) {
+                bad_request(res, "n must be a positive integer");
+                return;
+            }
+            
+            uint64_t p;
+            if (n <= (uint64_t)prime_table.size()) {
+                p = prime_table.nth(n - 1);
+            } else if (PrimeSieve::nth_bound(n) > (uint64_t)Config::SIEVE_MAX_SPAN) {
+                bad_request(res, "n too large (sieve span limited to " + to_string(Config::SIEVE_MAX_SPAN) + ")");
+                return;
+            } else {
+                cout << "  Sieving for prime #" << n << " (compute pool)..." << endl;
+                p = sieve.nth(n, &compute_pool);
+            }
+            
+            cout << "  ✓ Prime #" << n << " = " << p << endl;
+            res.status = 200;
+            res.set_content("{\"success\": true, \"n\": " + to_string(n) + ", \"prime\": " + to_string(p) + "}", "application/json");
             cout << "  [RESPONSE] 200 OK" << endl; });
 
         // compute hash
@@ -210,53 +775,142 @@ public:
             string text = req.get_param_value("text");
             cout << "  Text: '" << text << "'" << endl;
             
-            // check hash cache first
-            string cached_hash_str;
-            cout << "  Checking hash cache..." << endl;
-            if (hash_cache->get(text, cached_hash_str)) {
-                cout << "  ✓ HASH CACHE HIT - Hash: " << cached_hash_str << endl;
-                res.status = 200;
-                res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + cached_hash_str + ", \"source\": \"cache\"}", "application/json");
-                cout << "  [RESPONSE] 200 OK (from hash cache)" << endl;
+            Hash::Algo algo = Hash::POLY31;
+            if (req.has_param("algo") && !Hash::parse(req.get_param_value("algo"), algo)) {
+                bad_request(res, "unknown algo (poly31, xxh3, wyhash)");
                 return;
             }
             
-            cout << "  ✗ Hash cache miss, checking database..." << endl;
-            
-            // check db for previously computed hash
-            uint32_t db_hash;
-            if (db->get_hash(text, db_hash)) {
-                cout << "  ✓ Found in database - Hash: " << db_hash << endl;
-                hash_cache->put(text, to_string(db_hash));  // cache for future
-                cout << "  ✓ Cached for future requests" << endl;
+            // the fast algorithms run at GB/s, cheaper than any cache or db lookup
+            if (algo != Hash::POLY31) {
+                ProfileTimer compute(Profile::COMPUTE);
+                uint64_t h = Hash::hash(algo, text);
+                compute.stop();
+                cout << "  ✓ " << Hash::name(algo) << " computed: " << h << endl;
                 res.status = 200;
-                res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + to_string(db_hash) + ", \"source\": \"database\"}", "application/json");
-                cout << "  [RESPONSE] 200 OK (from database)" << endl;
+                res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"algo\": \"" + Hash::name(algo) + "\", \"hash\": " + to_string(h) + ", \"source\": \"computed\"}", "application/json");
+                cout << "  [RESPONSE] 200 OK (computed)" << endl;
                 return;
             }
             
-            cout << "  ✗ Not found in database, computing hash..." << endl;
+            // tiers worth checking for a text this long
+            bool use[CostModel::TIERS];
+            hash_cost.plan(text.size(), use);
             
-            // compute hash (not in cache or db)
-            uint32_t h = 0;
-            for (char c : text) {
-                h = h * 31 + c;
+            // check hash cache first
+            Hash::Fingerprint fp{};
+            uint32_t cached_hash;
+            if (use[CostModel::CACHE]) {
+                cout << "  Checking hash cache..." << endl;
+                auto t0 = CostModel::clock::now();
+                fp = Hash::fingerprint(text);
+                ProfileTimer lookup(Profile::CACHE);
+                bool hit = hash_cache->get(fp, cached_hash);
+                lookup.stop();
+                hash_cost.record_tier(CostModel::CACHE, CostModel::ns_since(t0));
+                if (hit) {
+                    hash_from_cache++;
+                    cout << "  ✓ HASH CACHE HIT - Hash: " << cached_hash << endl;
+                    res.status = 200;
+                    res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + to_string(cached_hash) + ", \"source\": \"cache\"}", "application/json");
+                    cout << "  [RESPONSE] 200 OK (from hash cache)" << endl;
+                    return;
+                }
+                cout << "  ✗ Hash cache miss" << endl;
             }
             
+            // check db for previously computed hash
+            uint32_t db_hash;
+            auto db_start = CostModel::clock::now();
+            if (use[CostModel::DB]) {
+                cout << "  Checking database..." << endl;
+                if (db->get_hash(text, db_hash)) {
+                    hash_cost.record_tier(CostModel::DB, CostModel::ns_since(db_start));
+                    hash_cost.record_db_lookup(true);
+                    hash_from_db++;
+                    cout << "  ✓ Found in database - Hash: " << db_hash << endl;
+                    if (use[CostModel::CACHE]) {
+                        hash_cache->put(fp, db_hash);  // cache for future
+                        cout << "  ✓ Cached for future requests" << endl;
+                    }
+                    res.status = 200;
+                    res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + to_string(db_hash) + ", \"source\": \"database\"}", "application/json");
+                    cout << "  [RESPONSE] 200 OK (from database)" << endl;
+                    return;
+                }
+                cout << "  ✗ Not found in database" << endl;
+            }
+            double db_lookup_ns = CostModel::ns_since(db_start);
+            
+            // compute hash
+            auto t0 = CostModel::clock::now();
+            ProfileTimer compute(Profile::COMPUTE);
+            uint32_t h = Hash::poly31(text.data(), text.size());
+            compute.stop();
+            hash_cost.record_compute(text.size(), CostModel::ns_since(t0));
             cout << "  ✓ Hash computed: " << h << endl;
             
-            // store in db and cache
-            cout << "  Writing to database..." << endl;
-            db->put_hash(text, h);
-            cout << "  ✓ Written to database" << endl;
+            if (!use[CostModel::CACHE] && !use[CostModel::DB]) {
+                // cheaper to recompute than to look up anywhere
+                hash_from_inline++;
+                res.status = 200;
+                res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + to_string(h) + ", \"source\": \"inline\"}", "application/json");
+                cout << "  [RESPONSE] 200 OK (computed inline, not stored)" << endl;
+                return;
+            }
             
-            hash_cache->put(text, to_string(h));
-            cout << "  ✓ Written to hash cache" << endl;
+            // store in the tiers that are worth it
+            if (use[CostModel::DB]) {
+                cout << "  Writing to database..." << endl;
+                auto w0 = CostModel::clock::now();
+                if (db->put_hash(text, h)) {
+                    // a miss only counts as a lookup cost once the db is known to work
+                    hash_cost.record_db_write(CostModel::ns_since(w0));
+                    hash_cost.record_tier(CostModel::DB, db_lookup_ns);
+                    hash_cost.record_db_lookup(false);
+                    cout << "  ✓ Written to database" << endl;
+                }
+            }
+            if (use[CostModel::CACHE]) {
+                ProfileTimer fill(Profile::CACHE);
+                hash_cache->put(fp, h);
+                fill.stop();
+                cout << "  ✓ Written to hash cache" << endl;
+            }
             
+            hash_from_computed++;
             res.status = 200;
             res.set_content("{\"success\": true, \"text\": \"" + text + "\", \"hash\": " + to_string(h) + ", \"source\": \"computed\"}", "application/json");
             cout << "  [RESPONSE] 200 OK (newly computed)" << endl; });
 
+        // hash the request body as it arrives, nothing is buffered
+        // (no text in the reply and no cache/db, the input isn't kept)
+        srv.Post("/compute/hash", [](const httplib::Request &req, httplib::Response &res, const httplib::ContentReader &content_reader)
+                 {
+            cout << "\n[REQUEST] POST /compute/hash from " << req.remote_addr << endl;
+            
+            Hash::Algo algo = Hash::POLY31;
+            if (req.has_param("algo") && !Hash::parse(req.get_param_value("algo"), algo)) {
+                bad_request(res, "unknown algo (poly31, xxh3, wyhash)");
+                return;
+            }
+            if (req.is_multipart_form_data()) {
+                bad_request(res, "send the text as the raw request body");
+                return;
+            }
+            
+            Hash::Stream stream(algo);
+            content_reader([&](const char *data, size_t len) {
+                stream.update(data, len);
+                return true;
+            });
+            
+            uint64_t h = stream.digest();
+            cout << "  ✓ " << Hash::name(algo) << " over " << stream.size() << " bytes: " << h << endl;
+            res.status = 200;
+            res.set_content("{\"success\": true, \"algo\": \"" + string(Hash::name(algo)) + "\", \"bytes\": " + to_string(stream.size()) + ", \"hash\": " + to_string(h) + ", \"source\": \"computed\"}", "application/json");
+            cout << "  [RESPONSE] 200 OK (streamed)" << endl; });
+
         // status
         srv.Get("/status", [this](const httplib::Request &req, httplib::Response &res)
                 {
@@ -273,7 +927,31 @@ public:
             json += "\"hash_cache_hits\": " + to_string(hash_cache->get_hits()) + ", ";
             json += "\"hash_cache_misses\": " + to_string(hash_cache->get_misses()) + ", ";
             json += "\"hash_cache_hit_rate\": " + to_string(hash_cache->hit_rate()) + ", ";
-            json += "\"hash_cache_evictions\": " + to_string(hash_cache->get_evictions());
+            json += "\"hash_cache_evictions\": " + to_string(hash_cache->get_evictions()) + ", ";
+            json += "\"hash_cache_bytes\": " + to_string(hash_cache->bytes()) + ", ";
+            json += "\"hash_source_cache\": " + to_string(hash_from_cache) + ", ";
+            json += "\"hash_source_database\": " + to_string(hash_from_db) + ", ";
+            json += "\"hash_source_computed\": " + to_string(hash_from_computed) + ", ";
+            json += "\"hash_source_inline\": " + to_string(hash_from_inline) + ", ";
+            json += hash_cost.stats_json() + ", ";
+            json += pool_stats("io_pool", io_pool, io_admit) + ", ";
+            json += pool_stats("compute_pool", &compute_pool, compute_admit);
+            if (binary) {
+                json += ", \"binary_connections\": " + to_string(binary->get_connections());
+                json += ", \"binary_requests\": " + to_string(binary->get_requests());
+                json += ", \"binary_timeouts\": " + to_string(binary->get_timeouts());
+            }
+            if (trace) {
+                json += ", \"trace_recorded\": " + to_string(trace->get_recorded());
+                json += ", \"trace_written\": " + to_string(trace->get_written());
+                json += ", \"trace_dropped\": " + to_string(trace->get_dropped());
+            }
+            if (pipeline) {
+                json += ", \"pipeline_connections\": " + to_string(pipeline->get_connections());
+                json += ", \"pipeline_requests\": " + to_string(pipeline->get_requests());
+                json += ", \"pipeline_batches\": " + to_string(pipeline->get_batches());
+                json += ", \"pipeline_timeouts\": " + to_string(pipeline->get_timeouts());
+            }
             json += "}}";
             
             cout << "  KV Cache: " << cache->size() << " items, "
@@ -284,11 +962,103 @@ public:
                       << hash_cache->get_hits() << " hits, "
                       << hash_cache->get_misses() << " misses ("
                       << hash_cache->hit_rate() << "% hit rate)" << endl;
+            if (io_pool) {
+                cout << "  I/O Pool: " << io_pool->get_active() << "/" << io_pool->size()
+                          << " busy, queue depth " << io_pool->queue_depth() << endl;
+            }
+            cout << "  Compute Pool: " << compute_pool.get_active() << "/" << compute_pool.size()
+                      << " busy, queue depth " << compute_pool.queue_depth() << endl;
+            cout << "  Shed: " << io_admit.get_shed_queue() + io_admit.get_shed_sojourn() << " io, "
+                      << compute_admit.get_shed_queue() + compute_admit.get_shed_sojourn() << " compute" << endl;
             
             res.status = 200;
             res.set_content(json, "application/json");
             cout << "  [RESPONSE] 200 OK" << endl; });
 
+        // Prometheus scrape target
+        srv.Get("/metrics", [this](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /metrics from " << req.remote_addr << endl;
+
+            string out;
+            http_metrics.write(out);
+            pool_metrics(out);
+            db->write_metrics(out);
+
+            Metrics::family(out, "kv_cache_items", "gauge", "Entries in the cache.");
+            Metrics::sample(out, "kv_cache_items", "cache=\"kv\"", cache->size());
+            Metrics::sample(out, "kv_cache_items", "cache=\"hash\"", hash_cache->size());
+            Metrics::family(out, "kv_cache_lookups_total", "counter", "Cache lookups by result.");
+            Metrics::sample(out, "kv_cache_lookups_total", "cache=\"kv\",result=\"hit\"", cache->get_hits());
+            Metrics::sample(out, "kv_cache_lookups_total", "cache=\"kv\",result=\"miss\"", cache->get_misses());
+            Metrics::sample(out, "kv_cache_lookups_total", "cache=\"hash\",result=\"hit\"", hash_cache->get_hits());
+            Metrics::sample(out, "kv_cache_lookups_total", "cache=\"hash\",result=\"miss\"", hash_cache->get_misses());
+            Metrics::family(out, "kv_cache_evictions_total", "counter", "Cache evictions.");
+            Metrics::sample(out, "kv_cache_evictions_total", "cache=\"kv\"", cache->get_evictions());
+            Metrics::sample(out, "kv_cache_evictions_total", "cache=\"hash\"", hash_cache->get_evictions());
+
+            Metrics::family(out, "kv_hash_source_total", "counter", "/compute/hash answers by where the result came from.");
+            Metrics::sample(out, "kv_hash_source_total", "source=\"cache\"", hash_from_cache);
+            Metrics::sample(out, "kv_hash_source_total", "source=\"database\"", hash_from_db);
+            Metrics::sample(out, "kv_hash_source_total", "source=\"computed\"", hash_from_computed);
+            Metrics::sample(out, "kv_hash_source_total", "source=\"inline\"", hash_from_inline);
+
+            if (binary || pipeline) {
+                Metrics::family(out, "kv_listener_connections", "gauge", "Open connections on the binary and pipelined listeners.");
+                if (binary) Metrics::sample(out, "kv_listener_connections", "listener=\"binary\"", binary->get_connections());
+                if (pipeline) Metrics::sample(out, "kv_listener_connections", "listener=\"pipeline\"", pipeline->get_connections());
+                Metrics::family(out, "kv_listener_requests_total", "counter", "Requests served by the binary and pipelined listeners.");
+                if (binary) Metrics::sample(out, "kv_listener_requests_total", "listener=\"binary\"", binary->get_requests());
+                if (pipeline) Metrics::sample(out, "kv_listener_requests_total", "listener=\"pipeline\"", pipeline->get_requests());
+                Metrics::family(out, "kv_listener_timeouts_total", "counter", "Connections closed for idling or for an unfinished request.");
+                if (binary) Metrics::sample(out, "kv_listener_timeouts_total", "listener=\"binary\"", binary->get_timeouts());
+                if (pipeline) Metrics::sample(out, "kv_listener_timeouts_total", "listener=\"pipeline\"", pipeline->get_timeouts());
+            }
+
+            res.status = 200;
+            res.set_content(out, "text/plain; version=0.0.4");
+            cout << "  [RESPONSE] 200 OK (" << out.size() << " bytes)" << endl; });
+
+        // per-stage profile: GET reads it, POST switches it
+        // (enable=0|1, route=kv_read or empty for all, reset=1)
+        auto profile_report = [](httplib::Response &res)
+        {
+            int route = Profile::route_filter.load();
+            uint64_t requests = Profile::count(Profile::REQUEST);
+            string json = "{\"success\": true, \"enabled\": " + string(Profile::on.load() ? "true" : "false");
+            json += ", \"route\": \"" + string(route < 0 ? "all" : Trace::name(route)) + "\"";
+            json += ", \"requests\": " + to_string(requests) + ", \"stages\": [";
+            for (int st = 0; st < Profile::STAGES; st++)
+                json += (st ? ", " : "") + Profile::stage_json(st, requests);
+            json += "]}";
+            res.status = 200;
+            res.set_content(json, "application/json");
+        };
+        srv.Get("/admin/profile", [profile_report](const httplib::Request &req, httplib::Response &res)
+                {
+            cout << "\n[REQUEST] GET /admin/profile from " << req.remote_addr << endl;
+            profile_report(res);
+            cout << "  [RESPONSE] 200 OK" << endl; });
+        srv.Post("/admin/profile", [this, profile_report](const httplib::Request &req, httplib::Response &res)
+                 {
+            cout << "\n[REQUEST] POST /admin/profile from " << req.remote_addr << endl;
+            
+            if (req.has_param("reset") && req.get_param_value("reset") == "1") {
+                Profile::reset();
+                cout << "  ✓ Profile reset" << endl;
+            }
+            if (req.has_param("enable") || req.has_param("route")) {
+                bool on = req.has_param("enable") ? req.get_param_value("enable") == "1" : Profile::on.load();
+                string route = req.get_param_value("route");
+                if (!set_profile(on, route)) {
+                    bad_request(res, "unknown route '" + route + "'");
+                    return;
+                }
+                cout << "  ✓ Profiling " << (on ? "on" : "off") << (route.empty() ? "" : " for " + route) << endl;
+            }
+            profile_report(res);
+            cout << "  [RESPONSE] 200 OK" << endl; });
+
         // generic error / not-found handler - return helpful JSON for bad endpoints
         srv.set_error_handler([](const httplib::Request &req, httplib::Response &res)
                               {
@@ -301,7 +1071,7 @@ public:
             int status = res.status ? res.status : 404;
             res.status = status;
 
-            string hint = "Valid endpoints: /kv/create (POST), /kv/read (GET), /kv/delete (DELETE), /compute/prime (GET), /compute/hash (GET), /status (GET)";
+            string hint = "Valid endpoints: /kv/create (POST), /kv/read (GET), /kv/delete (DELETE), /kv/mget (GET), /kv/mput (POST), /kv/bulk_load (POST), /kv/scan (GET), /compute/prime (GET), /compute/is_prime (GET), /compute/primes (GET), /compute/nth_prime (GET), /compute/hash (GET, POST), /status (GET), /metrics (GET), /admin/profile (GET, POST)";
             string json = "{\"error\": \"endpoint not found\", \"method\": \"" + req.method + "\", \"path\": \"" + req.path + "\", \"status\": " + to_string(status) + ", \"hint\": \"" + hint + "\"}";
             res.set_content(json, "application/json");
             cout << "  [RESPONSE] " << status << " Not Found (handled)" << endl; });
@@ -320,19 +1090,50 @@ public:
             res.set_content("{\"error\": \"internal server error\"}", "application/json"); });
     }
 
+    void set_binary(BinaryServer *b) { binary = b; }
+    void set_pipeline(PipelineServer *p) { pipeline = p; }
+    void set_trace(TraceRecorder *t) { trace = t; }
+
+    // switch per-stage profiling, route is a trace route name or "" for all
+    bool set_profile(bool on, const string &route)
+    {
+        int id = -1;
+        for (int r = 0; r < Trace::ROUTES && !route.empty(); r++)
+        {
+            if (route == Trace::name(r))
+                id = r;
+        }
+        if (!route.empty() && id < 0)
+            return false;
+        Profile::enable(on, id);
+        return true;
+    }
+
     void run()
     {
         cout << "\n========================================" << endl;
         cout << "Starting server on port " << Config::PORT << "..." << endl;
+        cout << "I/O pool: " << Config::IO_THREADS << " threads, compute pool: "
+             << compute_pool.size() << " threads" << endl;
         cout << "========================================" << endl;
         cout.flush();
 
-        srv.new_task_queue = []
-        { return new httplib::ThreadPool(Config::THREADS); };
+        // headers and body go out in separate sends; without TCP_NODELAY the
+        // body waits for the client's delayed ACK (~40 ms) on a reused connection
+        srv.set_tcp_nodelay(true);
+
+        // connection workers; httplib deletes the queue when listen() returns
+        srv.new_task_queue = [this]
+        {
+            io_pool = new Executor("io", Config::IO_THREADS, Config::IO_QUEUE_MAX);
+            return io_pool;
+        };
 
         // This is a BLOCKING call - server runs here
         // When successful, it blocks forever until stopped
-        if (!srv.listen(Config::HOST.c_str(), Config::PORT))
+        bool ok = srv.listen(Config::HOST.c_str(), Config::PORT);
+        io_pool = nullptr;
+        if (!ok)
         {
             cerr << "\n[ERROR] Failed to start server!" << endl;
             cerr << "Possible reasons:" << endl;
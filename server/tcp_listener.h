@@ -0,0 +1,189 @@
+#ifndef TCP_LISTENER_H
+#define TCP_LISTENER_H
+
+#include <string>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "executor.h"
+#include "../include/config.h"
+
+using namespace std;
+
+// plain TCP listener: accepts in the background and hands each connection
+// to serve() on its own executor. Base for the non-httplib front ends.
+//
+// A connection holds its worker until it closes, so serve() reads with
+// recv_by() and a deadline from next_deadline(): idle_timeout between
+// requests, read_timeout once a request has started arriving. Without them
+// a few idle or slow clients would hold every worker.
+class TcpListener
+{
+private:
+    int listen_fd = -1;
+    thread acceptor;
+    atomic<bool> running{false};
+
+    mutex conn_mtx;
+    set<int> conns; // open client sockets, shut down on stop()
+
+    void accept_loop()
+    {
+        while (running)
+        {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (!running)
+                    break;
+                continue;
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            {
+                lock_guard<mutex> lock(conn_mtx);
+                conns.insert(fd);
+            }
+            connections++;
+
+            if (!pool.enqueue([this, fd]
+                              { serve(fd); closed(fd); }))
+            {
+                closed(fd);
+            }
+        }
+    }
+
+    void closed(int fd)
+    {
+        {
+            lock_guard<mutex> lock(conn_mtx);
+            conns.erase(fd);
+        }
+        close(fd);
+    }
+
+protected:
+    using clock = chrono::steady_clock;
+
+    Executor pool;
+    atomic<long> connections{0};
+    atomic<long> timeouts{0}; // connections closed by a deadline
+    const chrono::seconds idle_timeout{Config::IDLE_TIMEOUT_S};
+    const chrono::seconds read_timeout{Config::READ_TIMEOUT_S};
+
+    // handle one connection until the client is done, the fd is closed afterwards
+    virtual void serve(int fd) = 0;
+
+    // recv, waiting no later than deadline; <= 0 when the peer closed, on
+    // error or when the deadline passed
+    ssize_t recv_by(int fd, char *buf, size_t len, clock::time_point deadline)
+    {
+        for (;;)
+        {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - clock::now()).count();
+            struct pollfd p = {fd, POLLIN, 0};
+            int r = left > 0 ? poll(&p, 1, (int)left) : 0;
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r == 0)
+                timeouts++;
+            if (r <= 0)
+                return -1;
+            return recv(fd, buf, len, 0);
+        }
+    }
+
+    // deadline for the next read once a read is handled: idle_timeout when
+    // nothing is left buffered, read_timeout from when the unfinished request
+    // in the buffer started (started: it began in this read)
+    clock::time_point next_deadline(bool buffered, bool started, clock::time_point current)
+    {
+        if (!buffered)
+            return clock::now() + idle_timeout;
+        return started ? clock::now() + read_timeout : current;
+    }
+
+    bool send_all(int fd, const string &data)
+    {
+        size_t off = 0;
+        while (off < data.size())
+        {
+            ssize_t n = send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            off += n;
+        }
+        return true;
+    }
+
+public:
+    TcpListener(const string &name, int threads) : pool(name, threads) {}
+
+    // subclasses must call stop() in their destructor, serve() is virtual
+    virtual ~TcpListener() = default;
+
+    // bind and start accepting in the background
+    bool start(const string &host, int port)
+    {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0)
+            return false;
+
+        int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) <= 0 ||
+            bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            listen(listen_fd, 1024) < 0)
+        {
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+
+        running = true;
+        acceptor = thread([this]
+                          { accept_loop(); });
+        return true;
+    }
+
+    void stop()
+    {
+        if (!running.exchange(false))
+            return;
+
+        shutdown(listen_fd, SHUT_RDWR);
+        close(listen_fd);
+        if (acceptor.joinable())
+            acceptor.join();
+
+        // wake workers blocked in recv()
+        {
+            lock_guard<mutex> lock(conn_mtx);
+            for (int fd : conns)
+                shutdown(fd, SHUT_RDWR);
+        }
+        pool.shutdown();
+    }
+
+    long get_connections() { return connections; }
+    long get_timeouts() { return timeouts; }
+};
+
+#endif
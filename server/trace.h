@@ -0,0 +1,288 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// compact binary request trace, written by the server (trace_file option)
+// and replayed by the load generator (--replay)
+//
+// file: Header, then one 24-byte Record per request in arrival order,
+// little-endian. Keys and hash texts are stored as 64-bit hashes only, so
+// a trace keeps the access pattern (which requests repeat, how big the
+// values are, when they arrive) without any of the data.
+namespace Trace
+{
+    enum Route : uint8_t
+    {
+        OTHER = 0,
+        KV_CREATE = 1,   // key: hash of key     size: value bytes
+        KV_READ = 2,     // key: hash of key
+        KV_DELETE = 3,   // key: hash of key
+        KV_MGET = 4,     // key: hash of 1st key size: key count
+        KV_MPUT = 5,     // key: hash of 1st key size: pair count  extra: bytes per value
+        KV_SCAN = 6,     // key: hash of prefix  size: limit
+        PRIME = 7,       //                      size: count
+        IS_PRIME = 8,    // key: n
+        PRIMES = 9,      // key: from            size: to - from
+        NTH_PRIME = 10,  // key: n
+        HASH = 11,       // key: hash of text    size: text bytes  extra: algo
+        HASH_STREAM = 12, //                     size: body bytes  extra: algo
+        STATUS = 13,
+        KV_BULK_LOAD = 14, //                    size: body bytes
+        ROUTES
+    };
+
+    inline const char *name(uint8_t r)
+    {
+        static const char *names[] = {"other", "kv_create", "kv_read", "kv_delete", "kv_mget",
+                                      "kv_mput", "kv_scan", "prime", "is_prime", "primes",
+                                      "nth_prime", "hash", "hash_stream", "status", "kv_bulk_load"};
+        return r < ROUTES ? names[r] : "other";
+    }
+
+    inline Route route(const string &method, const string &path)
+    {
+        if (path == "/kv/read")
+            return KV_READ;
+        if (path == "/kv/create")
+            return KV_CREATE;
+        if (path == "/kv/delete")
+            return KV_DELETE;
+        if (path == "/kv/mget")
+            return KV_MGET;
+        if (path == "/kv/mput")
+            return KV_MPUT;
+        if (path == "/kv/scan")
+            return KV_SCAN;
+        if (path == "/kv/bulk_load")
+            return KV_BULK_LOAD;
+        if (path == "/compute/prime")
+            return PRIME;
+        if (path == "/compute/is_prime")
+            return IS_PRIME;
+        if (path == "/compute/primes")
+            return PRIMES;
+        if (path == "/compute/nth_prime")
+            return NTH_PRIME;
+        if (path == "/compute/hash")
+            return method == "POST" ? HASH_STREAM : HASH;
+        if (path == "/status")
+            return STATUS;
+        return OTHER;
+    }
+
+    const char MAGIC[8] = {'K', 'V', 'T', 'R', 'A', 'C', 'E', '1'};
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t start_unix_us; // wall clock when recording started
+    };
+
+    struct Record
+    {
+        uint64_t t_us;  // arrival, microseconds since start
+        uint64_t key;   // see Route
+        uint32_t size;  // see Route
+        uint16_t extra; // see Route
+        uint8_t route;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 24 && sizeof(Record) == 24, "trace layout");
+
+    // whole trace file into memory, false (with err set) if it isn't one
+    inline bool load(const string &path, Header &header, vector<Record> &records, string &err)
+    {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+        {
+            err = "cannot open " + path;
+            return false;
+        }
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+                  memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                  header.version == 1 && header.record_size == sizeof(Record);
+        if (!ok)
+        {
+            err = path + " is not a version 1 kv trace";
+            fclose(f);
+            return false;
+        }
+        records.clear();
+        Record buf[4096];
+        size_t n;
+        while ((n = fread(buf, sizeof(Record), 4096, f)) > 0)
+            records.insert(records.end(), buf, buf + n);
+        fclose(f);
+
+        // recording threads can take ring slots slightly out of arrival order
+        stable_sort(records.begin(), records.end(), [](const Record &a, const Record &b)
+                    { return a.t_us < b.t_us; });
+        return true;
+    }
+}
+
+// records requests into a lock-free ring, a background thread appends them
+// to the trace file every 100 ms. Handlers never block or do I/O: if the
+// writer falls a whole ring behind, new records are dropped and counted.
+class TraceRecorder
+{
+private:
+    using clock = chrono::steady_clock;
+
+    // bounded MPSC ring (Vyukov): seq == index means free for that lap,
+    // seq == index + 1 means written and ready for the writer
+    struct Slot
+    {
+        atomic<uint64_t> seq;
+        Trace::Record rec;
+    };
+
+    vector<Slot> slots;
+    uint64_t mask;
+    atomic<uint64_t> head{0};
+    uint64_t tail = 0; // writer thread only
+
+    FILE *out = nullptr;
+    clock::time_point start;
+    thread writer;
+    atomic<bool> running{false};
+
+    atomic<long> recorded{0};
+    atomic<long> dropped{0};
+    atomic<long> written{0};
+
+    // move every ready record to the file
+    void drain()
+    {
+        Trace::Record batch[1024];
+        size_t n = 0;
+        for (;;)
+        {
+            Slot &s = slots[tail & mask];
+            if (s.seq.load(memory_order_acquire) != tail + 1)
+                break;
+            batch[n++] = s.rec;
+            s.seq.store(tail + slots.size(), memory_order_release);
+            tail++;
+            if (n == 1024)
+            {
+                fwrite(batch, sizeof(Trace::Record), n, out);
+                written += n;
+                n = 0;
+            }
+        }
+        if (n)
+        {
+            fwrite(batch, sizeof(Trace::Record), n, out);
+            written += n;
+        }
+        fflush(out);
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    TraceRecorder(size_t capacity)
+    {
+        size_t n = 1024;
+        while (n < capacity)
+            n <<= 1;
+        slots = vector<Slot>(n);
+        mask = n - 1;
+        for (size_t i = 0; i < n; i++)
+            slots[i].seq.store(i, memory_order_relaxed);
+    }
+
+    ~TraceRecorder() { stop(); }
+
+    bool start_file(const string &path)
+    {
+        out = fopen(path.c_str(), "wb");
+        if (!out)
+            return false;
+
+        Trace::Header h{};
+        memcpy(h.magic, Trace::MAGIC, sizeof(h.magic));
+        h.version = 1;
+        h.record_size = sizeof(Trace::Record);
+        h.start_unix_us = chrono::duration_cast<chrono::microseconds>(
+                              chrono::system_clock::now().time_since_epoch())
+                              .count();
+        fwrite(&h, sizeof(h), 1, out);
+
+        start = clock::now();
+        running = true;
+        writer = thread([this]
+                        {
+            while (running.load()) {
+                this_thread::sleep_for(chrono::milliseconds(100));
+                drain();
+            } });
+        return true;
+    }
+
+    // flush what is buffered and close the file
+    void stop()
+    {
+        if (!running.exchange(false))
+            return;
+        writer.join();
+        drain();
+        fclose(out);
+        out = nullptr;
+    }
+
+    void record(Trace::Route route, uint64_t key, uint32_t size, uint16_t extra = 0)
+    {
+        if (!running.load(memory_order_relaxed))
+            return;
+
+        uint64_t t = chrono::duration_cast<chrono::microseconds>(clock::now() - start).count();
+        uint64_t pos = head.load(memory_order_relaxed);
+        Slot *s;
+        for (;;)
+        {
+            s = &slots[pos & mask];
+            int64_t diff = (int64_t)(s->seq.load(memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                dropped.fetch_add(1, memory_order_relaxed); // ring full
+                return;
+            }
+            else
+            {
+                pos = head.load(memory_order_relaxed);
+            }
+        }
+
+        s->rec = Trace::Record{t, key, size, extra, (uint8_t)route, 0};
+        s->seq.store(pos + 1, memory_order_release);
+        recorded.fetch_add(1, memory_order_relaxed);
+    }
+
+    bool is_running() const { return running.load(); }
+    long get_recorded() const { return recorded.load(); }
+    long get_dropped() const { return dropped.load(); }
+    long get_written() const { return written.load(); }
+    size_t capacity() const { return slots.size(); }
+};
+
+#endif
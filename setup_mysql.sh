@@ -22,6 +22,8 @@ CREATE TABLE IF NOT EXISTS kv_pairs (
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
 -- Create hash table (using text prefix + hash to avoid both size limits AND collisions)
+-- text_hash is compute_text_hash() in compute/hash.h; when its format changes,
+-- TRUNCATE hash_store (rows are recomputable) or old rows are never found again
 CREATE TABLE IF NOT EXISTS hash_store (
     id BIGINT UNSIGNED AUTO_INCREMENT PRIMARY KEY,
     text_prefix VARCHAR(255) NOT NULL,  -- First 255 chars of text